@@ -13,5 +13,4 @@ include_directories (${catch}/single_include)
 set (sources
     src/angle.cpp
     src/math/math.cpp
-    src/math/round.cpp
 )
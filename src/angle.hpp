@@ -14,13 +14,45 @@ enum class AngleType { DEG, RAD };
 /**
  * @class This class stores an angle between 0-360 degree
  * /0 - 2pi radian.
+ *
+ * All functions are constexpr, so constant angles (like
+ * mounting offsets and scan steps) are computed at compile time.
  */
 class Angle {
   private:
     double angleInDeg;
 
   public:
-    static const double pi;
+    static constexpr double pi = 3.14159265358979323846;
+
+  private:
+    /**
+     * @brief Returns an angle in degrees, capped in valid range.
+     *
+     * @param [in] type: Specifies the unit of the
+     * angle value that is given.
+     *
+     * @param [in] value: The value of the angle.
+     *
+     * @return [double] - The angle in degrees, between 0 - 360.
+     */
+    static constexpr double toDegrees(AngleType type, double value) {
+        if (type == AngleType::RAD) {
+            if (value < 0) {
+                value -= (int(value / ((2 * pi))) * (2 * pi));
+                value = 2 * pi + value;
+                return value * (180 / pi);
+            }
+            return (value - int(value / (2 * pi)) * 2 * pi) * (180 / pi);
+        }
+        if (value < 0) {
+            value -= (int(value / 360) * 360);
+            return 360 + value;
+        }
+        return value - int(value / 360) * 360;
+    }
+
+  public:
     /**
      * @brief ctor
      *
@@ -28,7 +60,8 @@ class Angle {
      * initialize the angle as 0 degrees.
      *
      */
-    Angle();
+    constexpr Angle() : angleInDeg(0) {
+    }
 
     /**
      * @brief ctor
@@ -44,7 +77,8 @@ class Angle {
      * this can be any number, but it will be capped
      * in valid range.
      */
-    Angle(AngleType type, double value);
+    constexpr Angle(AngleType type, double value) : angleInDeg(toDegrees(type, value)) {
+    }
 
     /**
      * @brief Sets a new angle.
@@ -59,7 +93,9 @@ class Angle {
      * this can be any number, but it will be capped
      * in valid range.
      */
-    void set(AngleType type, double value);
+    constexpr void set(AngleType type, double value) {
+        angleInDeg = toDegrees(type, value);
+    }
 
     /**
      * @brief Returns the stored angle as  degree.
@@ -68,7 +104,9 @@ class Angle {
      * @return [double] - The stored angle as degree.
      * The value will be between 0 - 360.
      */
-    double asDegree() const;
+    constexpr double asDegree() const {
+        return angleInDeg;
+    }
 
     /**
      * @brief Returns the stored angle as radian.
@@ -77,35 +115,49 @@ class Angle {
      * @return [double] - The stored angle as radian.
      * The value will be between 0 - 2pi.
      */
-    double asRadian() const;
+    constexpr double asRadian() const {
+        return angleInDeg / (180 / pi);
+    }
 
     /**
      *
      * @brief += operator for angle.
      *
      */
-    Angle &operator+=(const Angle &other);
+    constexpr Angle &operator+=(const Angle &other) {
+        angleInDeg += other.angleInDeg;
+        angleInDeg = angleInDeg - int(angleInDeg / 360) * 360;
+        return *this;
+    }
 
     /**
      *
      * @brief + operator for angle.
      *
      */
-    Angle operator+(const Angle &other);
+    constexpr Angle operator+(const Angle &other) const {
+        return Angle(AngleType::DEG, angleInDeg + other.angleInDeg);
+    }
 
     /**
      *
      * @brief -= operator for angle.
      *
      */
-    Angle &operator-=(const Angle &other);
+    constexpr Angle &operator-=(const Angle &other) {
+        angleInDeg -= other.angleInDeg;
+        angleInDeg = angleInDeg - int(angleInDeg / 360) * 360;
+        return *this;
+    }
 
     /**
      *
      * @brief - operator for angle.
      *
      */
-    Angle operator-(const Angle &other);
+    constexpr Angle operator-(const Angle &other) const {
+        return Angle(AngleType::DEG, angleInDeg - other.angleInDeg);
+    }
 };
 } // namespace Mapping
 
@@ -0,0 +1,861 @@
+/**
+ * @file
+ * @brief     Bit-packed 2D grid class
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef BITGRID_HPP
+#define BITGRID_HPP
+
+#include "vector2d.hpp"
+#include <array>
+#include <stdint.h>
+
+namespace Mapping {
+/**
+ * @brief The ways bits can be written to a BitGrid.
+ */
+enum class BitOperation {
+    COPY, ///< The bits are overwritten.
+    SET,  ///< The set bits are set (or).
+    CLEAR ///< The set bits are cleared (and not).
+};
+
+/**
+ * @brief This class iterates over the set bits of a rectangle of a bit-packed grid.
+ *
+ * The source has to give the bits of its rows 32 at a time, with
+ * getRowWord(y, wordInRow), in the layout of BitGrid. Words without
+ * set bits are skipped as a whole, and the set bits within a word are
+ * found with count-trailing-zeros, so the cost is proportional to the
+ * amount of words and set bits, not to the amount of points. The bits
+ * are visited row by row.
+ *
+ * @tparam Source: The type of the grid.
+ */
+template <class Source>
+class SetBitIterator {
+  private:
+    static constexpr int bitsPerWord = 32;
+
+    const Source *source;
+    int x0;
+    int x1;
+    int y1;
+    int y;
+    int wordInRow;
+    uint32_t bits;
+
+    void load() {
+        uint32_t mask = ~uint32_t(0);
+        if (wordInRow == x0 / bitsPerWord) {
+            mask &= ~uint32_t(0) << (x0 % bitsPerWord);
+        }
+        if (wordInRow == x1 / bitsPerWord) {
+            mask &= ~uint32_t(0) >> (bitsPerWord - 1 - x1 % bitsPerWord);
+        }
+        bits = source->getRowWord(y, wordInRow) & mask;
+    }
+
+    void skipEmptyWords() {
+        while (bits == 0 && y <= y1) {
+            if (++wordInRow > x1 / bitsPerWord) {
+                wordInRow = x0 / bitsPerWord;
+                if (++y > y1) {
+                    return;
+                }
+            }
+            load();
+        }
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * Points to the first set bit of the rectangle. The corners are
+     * inclusive and have to be within the grid; when y0 > y1 the
+     * iterator is at the end.
+     */
+    SetBitIterator(const Source &source, int x0, int y0, int x1, int y1)
+        : source(&source), x0(x0), x1(x1), y1(y1), y(y0), wordInRow(x0 / bitsPerWord), bits(0) {
+        if (y <= y1) {
+            load();
+            skipEmptyWords();
+        }
+    }
+
+    /**
+     * @brief Returns the position of the current set bit.
+     */
+    Vector2D operator*() const {
+        return Vector2D(wordInRow * bitsPerWord + __builtin_ctz(bits), y);
+    }
+
+    /**
+     * @brief Moves to the next set bit.
+     */
+    SetBitIterator &operator++() {
+        bits &= bits - 1;
+        skipEmptyWords();
+        return *this;
+    }
+
+    bool operator==(const SetBitIterator &other) const {
+        return y == other.y && wordInRow == other.wordInRow && bits == other.bits;
+    }
+
+    bool operator!=(const SetBitIterator &other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief The set bits of a rectangle of a grid, for use in a range-based for loop.
+ *
+ * @tparam Source: The type of the grid, see SetBitIterator.
+ */
+template <class Source>
+class SetBitRange {
+  private:
+    const Source &source;
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+
+  public:
+    SetBitRange(const Source &source, int x0, int y0, int x1, int y1) : source(source), x0(x0), y0(y0), x1(x1), y1(y1) {
+    }
+
+    SetBitIterator<Source> begin() const {
+        return SetBitIterator<Source>(source, x0, y0, x1, y1);
+    }
+
+    SetBitIterator<Source> end() const {
+        return SetBitIterator<Source>(source, x0, y1 + 1, x1, y1);
+    }
+};
+
+/**
+ * @brief The offsets of the 8 neighbors of a grid point, see BitGrid::getNeighborhood().
+ */
+namespace Neighborhood {
+constexpr int size = 8;
+constexpr int offsetX[size] = {-1, 0, 1, -1, 1, -1, 0, 1};
+constexpr int offsetY[size] = {-1, -1, -1, 0, 0, 1, 1, 1};
+} // namespace Neighborhood
+
+/**
+ * @brief Stores the bits row by row, see BitGrid.
+ */
+struct RowMajorLayout {};
+
+/**
+ * @brief Stores the bits in small tiles in Morton (Z) order, see BitGrid.
+ */
+struct MortonLayout {};
+
+/**
+ * @brief Maps grid points to storage words, for a layout.
+ *
+ * Every layout gives the storage word and bit of a point, and reads
+ * and writes "row words": 32 consecutive points of a row, in the
+ * layout of RowMajorLayout. The operations on whole rows are built on
+ * the row words, so they work the same for every layout.
+ */
+template <class Layout, int X, int Y>
+struct GridLayout;
+
+/**
+ * @brief Row-major layout.
+ *
+ * The bits are packed into 32 bit words, row by row: a row contains
+ * all points with the same y coordinate, starting at x = 0 in the least
+ * significant bit of the first word of the row. Every row starts in a
+ * new word. Points next to each other in the x direction share a word,
+ * but points above each other are a whole row apart.
+ */
+template <int X, int Y>
+struct GridLayout<RowMajorLayout, X, Y> {
+    static constexpr int wordsPerRow = (X + 31) / 32;
+    static constexpr int wordCount = wordsPerRow * Y;
+
+    static int wordIndex(int x, int y) {
+        return y * wordsPerRow + x / 32;
+    }
+
+    static uint32_t bitMask(int x, int) {
+        return uint32_t(1) << (x % 32);
+    }
+
+    static uint32_t readRowWord(const uint32_t *words, int y, int wordInRow) {
+        return words[y * wordsPerRow + wordInRow];
+    }
+
+    static void writeRowWord(uint32_t *words, int y, int wordInRow, uint32_t mask, uint32_t bits) {
+        uint32_t &word = words[y * wordsPerRow + wordInRow];
+        word = (word & ~mask) | (bits & mask);
+    }
+
+    /**
+     * @brief Returns the 3 bits of a row from x to x + 2, which have to be within the grid.
+     */
+    static uint32_t readTriple(const uint32_t *words, int x, int y) {
+        const uint32_t *word = &words[y * wordsPerRow + x / 32];
+        const int shift = x % 32;
+        uint32_t bits = word[0] >> shift;
+        if (shift > 29) {
+            bits |= word[1] << (32 - shift);
+        }
+        return bits & 7;
+    }
+};
+
+/**
+ * @brief Morton tiled layout.
+ *
+ * The grid is divided in tiles of 8 x 8 points, stored tile row by tile
+ * row. Every tile takes 2 words: the top and the bottom 8 x 4 points.
+ * Within a word the points are in Morton order, the bits of x and y are
+ * interleaved: bit (x0 | y0 << 1 | x1 << 2 | y1 << 3 | x2 << 4) is point
+ * (x, y) of the half tile. A trace in any direction touches a new word
+ * only every 4 to 8 points, but finding a point takes more instructions
+ * than in the row-major layout, which is faster in practice (see
+ * tools/layout_bench.cpp).
+ */
+template <int X, int Y>
+struct GridLayout<MortonLayout, X, Y> {
+    static constexpr int tilesPerRow = (X + 7) / 8;
+    static constexpr int wordCount = tilesPerRow * ((Y + 7) / 8) * 2;
+
+    /**
+     * @brief Returns the bit index of a point within its word.
+     */
+    static int mortonIndex(int x, int y) {
+        return (x & 1) | (y & 1) << 1 | (x & 2) << 1 | (y & 2) << 2 | (x & 4) << 2;
+    }
+
+    /**
+     * @brief Gathers the 8 bits of row 0 of a word (after shifting it to row 0).
+     */
+    static uint32_t compressRow(uint32_t word) {
+        word &= 0x00330033;
+        word = (word | word >> 2) & 0x000F000F;
+        return (word | word >> 12) & 0xFF;
+    }
+
+    /**
+     * @brief Spreads 8 bits over row 0 of a word, the inverse of compressRow().
+     */
+    static uint32_t expandRow(uint32_t bits) {
+        bits = (bits | bits << 12) & 0x000F000F;
+        return (bits | bits << 2) & 0x00330033;
+    }
+
+    static int wordIndex(int x, int y) {
+        ///< Coordinates are never negative, shifts avoid the rounding of signed division.
+        return ((unsigned(y) >> 3) * tilesPerRow + (unsigned(x) >> 3)) * 2 + ((unsigned(y) >> 2) & 1);
+    }
+
+    static uint32_t bitMask(int x, int y) {
+        return uint32_t(1) << mortonIndex(x, y);
+    }
+
+    static uint32_t readRowWord(const uint32_t *words, int y, int wordInRow) {
+        const int shift = mortonIndex(0, y % 4);
+        uint32_t result = 0;
+        for (int i = 0; i < 4 && wordInRow * 4 + i < tilesPerRow; ++i) {
+            result |= compressRow(words[wordIndex((wordInRow * 4 + i) * 8, y)] >> shift) << (8 * i);
+        }
+        return result;
+    }
+
+    static void writeRowWord(uint32_t *words, int y, int wordInRow, uint32_t mask, uint32_t bits) {
+        const int shift = mortonIndex(0, y % 4);
+        for (int i = 0; i < 4 && wordInRow * 4 + i < tilesPerRow; ++i) {
+            const uint32_t tileMask = expandRow((mask >> (8 * i)) & 0xFF) << shift;
+            if (tileMask != 0) {
+                uint32_t &word = words[wordIndex((wordInRow * 4 + i) * 8, y)];
+                word = (word & ~tileMask) | ((expandRow((bits >> (8 * i)) & 0xFF) << shift) & tileMask);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the 8 bits of row y of a tile.
+     */
+    static uint32_t readTileRow(const uint32_t *words, int tileX, int y) {
+        return compressRow(words[wordIndex(tileX * 8, y)] >> mortonIndex(0, y % 4));
+    }
+
+    /**
+     * @brief Returns the 3 bits of a row from x to x + 2, which have to be within the grid.
+     */
+    static uint32_t readTriple(const uint32_t *words, int x, int y) {
+        const int shift = x & 7;
+        uint32_t bits = readTileRow(words, x >> 3, y) >> shift;
+        if (shift > 5) {
+            bits |= readTileRow(words, (x >> 3) + 1, y) << (8 - shift);
+        }
+        return bits & 7;
+    }
+};
+
+/**
+ * @brief This class stores a 2D grid of bits.
+ *
+ * Every grid point takes a single bit. How the bits are packed into
+ * 32 bit words depends on the layout, see RowMajorLayout and
+ * MortonLayout. Whatever the layout, the bits of a row can be read and
+ * written 32 at a time as row words: bit i of row word k of row y is
+ * point (32 * k + i, y). The unused bits past the end of a row are
+ * always 0.
+ *
+ * The grid is also divided in square tiles of tileSize x tileSize
+ * points. Tiles are used to keep information about a whole region
+ * of the grid, instead of every point separately.
+ *
+ * @tparam Layout: The storage layout, RowMajorLayout (the default) or MortonLayout.
+ */
+template <int X, int Y, class Layout = RowMajorLayout>
+class BitGrid {
+  public:
+    ///< The width of the grid.
+    static constexpr int width = X;
+    ///< The height of the grid.
+    static constexpr int height = Y;
+    ///< The amount of bits in a storage word.
+    static constexpr int bitsPerWord = 32;
+    ///< The amount of row words in a single row.
+    static constexpr int wordsPerRow = (X + bitsPerWord - 1) / bitsPerWord;
+    ///< The total amount of storage words.
+    static constexpr int wordCount = GridLayout<Layout, X, Y>::wordCount;
+    ///< The width and height of a tile.
+    static constexpr int tileSize = 8;
+    ///< The amount of tiles next to each other in the x direction.
+    static constexpr int tilesPerRow = (X + tileSize - 1) / tileSize;
+    ///< The total amount of tiles.
+    static constexpr int tileCount = tilesPerRow * ((Y + tileSize - 1) / tileSize);
+
+  private:
+    using Storage = GridLayout<Layout, X, Y>;
+
+    std::array<uint32_t, wordCount> words;
+
+    static constexpr uint32_t lowMask(int count) {
+        return count >= bitsPerWord ? ~uint32_t(0) : (uint32_t(1) << count) - 1;
+    }
+
+    uint32_t rowWord(int y, int wordInRow) const {
+        return Storage::readRowWord(words.data(), y, wordInRow);
+    }
+
+    /**
+     * @brief Replaces the bits of a row word that are set in the mask.
+     */
+    void writeRowWord(int y, int wordInRow, uint32_t mask, uint32_t bits) {
+        Storage::writeRowWord(words.data(), y, wordInRow, mask, bits);
+    }
+
+    void applyToRowWord(int y, int wordInRow, uint32_t mask, uint32_t bits, BitOperation operation) {
+        if (operation == BitOperation::SET) {
+            bits |= rowWord(y, wordInRow);
+        } else if (operation == BitOperation::CLEAR) {
+            bits = rowWord(y, wordInRow) & ~bits;
+        }
+        writeRowWord(y, wordInRow, mask, bits);
+    }
+
+    /**
+     * @brief Returns the bits of a word that lie in the span [x0, x1].
+     */
+    static uint32_t spanMask(int wordInRow, int x0, int x1) {
+        const int first = x0 - wordInRow * bitsPerWord;
+        const int last = x1 - wordInRow * bitsPerWord;
+        const uint32_t fromFirst = first <= 0 ? ~uint32_t(0) : ~uint32_t(0) << first;
+        const uint32_t toLast = last >= bitsPerWord - 1 ? ~uint32_t(0) : ~uint32_t(0) >> (bitsPerWord - 1 - last);
+        return fromFirst & toLast;
+    }
+
+  public:
+    /**
+     * @brief Read only view on a single column of the grid.
+     *
+     * This allows the grid to be read as grid[x][y], like
+     * a 2D array.
+     */
+    class Column {
+      private:
+        const BitGrid &grid;
+        int x;
+
+      public:
+        Column(const BitGrid &grid, int x) : grid(grid), x(x) {
+        }
+
+        bool operator[](int y) const {
+            return grid.get(x, y);
+        }
+    };
+
+    /**
+     * @brief ctor
+     *
+     * Constructs a grid with all the bits cleared.
+     */
+    BitGrid() {
+        clear();
+    }
+
+    /**
+     * @brief Returns the bit of the given grid point.
+     *
+     * @param [in] x: The x coordinate, 0 <= x < X.
+     *
+     * @param [in] y: The y coordinate, 0 <= y < Y.
+     *
+     * @return [bool] - True if the bit is set.
+     */
+    bool get(int x, int y) const {
+        return (words[Storage::wordIndex(x, y)] & Storage::bitMask(x, y)) != 0;
+    }
+
+    /**
+     * @brief Returns the index of the tile that contains the point.
+     *
+     * @param [in] x: The x coordinate, 0 <= x < X.
+     *
+     * @param [in] y: The y coordinate, 0 <= y < Y.
+     *
+     * @return [int] - The tile index, 0 <= index < tileCount.
+     */
+    static constexpr int tileIndex(int x, int y) {
+        return (y / tileSize) * tilesPerRow + x / tileSize;
+    }
+
+    /**
+     * @brief Returns a column of the grid.
+     *
+     * @param [in] x: The x coordinate of the column, 0 <= x < X.
+     *
+     * @return [Column] - The column, which can be indexed with y.
+     */
+    Column operator[](int x) const {
+        return Column(*this, x);
+    }
+
+    /**
+     * @brief Sets the bit of the given grid point.
+     *
+     * @param [in] x: The x coordinate, 0 <= x < X.
+     *
+     * @param [in] y: The y coordinate, 0 <= y < Y.
+     */
+    void set(int x, int y) {
+        words[Storage::wordIndex(x, y)] |= Storage::bitMask(x, y);
+    }
+
+    /**
+     * @brief Clears the bit of the given grid point.
+     *
+     * @param [in] x: The x coordinate, 0 <= x < X.
+     *
+     * @param [in] y: The y coordinate, 0 <= y < Y.
+     */
+    void reset(int x, int y) {
+        words[Storage::wordIndex(x, y)] &= ~Storage::bitMask(x, y);
+    }
+
+    /**
+     * @brief Returns if a span has bits set that are not set in another grid.
+     *
+     * @param [in] y: The row of the span, 0 <= y < Y.
+     *
+     * @param [in] x0: The first x coordinate of the span.
+     *
+     * @param [in] x1: The last x coordinate of the span (inclusive), x0 <= x1 < X.
+     *
+     * @param [in] keep: The bits that are set in this grid are not taken into account.
+     */
+    bool anyInSpanExcept(int y, int x0, int x1, const BitGrid &keep) const {
+        for (int wordInRow = x0 / bitsPerWord; wordInRow <= x1 / bitsPerWord; ++wordInRow) {
+            if ((rowWord(y, wordInRow) & spanMask(wordInRow, x0, x1) & ~keep.rowWord(y, wordInRow)) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Clears the bits of a span that are not set in another grid.
+     *
+     * Works a whole storage word at a time.
+     *
+     * @param [in] y: The row of the span, 0 <= y < Y.
+     *
+     * @param [in] x0: The first x coordinate of the span.
+     *
+     * @param [in] x1: The last x coordinate of the span (inclusive), x0 <= x1 < X.
+     *
+     * @param [in] keep: The bits that are set in this grid are not cleared.
+     *
+     * @param [in] onCleared: Called as onCleared(x) for every bit that got cleared.
+     */
+    template <class F>
+    void clearSpanExcept(int y, int x0, int x1, const BitGrid &keep, F onCleared) {
+        for (int wordInRow = x0 / bitsPerWord; wordInRow <= x1 / bitsPerWord; ++wordInRow) {
+            const uint32_t cleared = rowWord(y, wordInRow) & spanMask(wordInRow, x0, x1) & ~keep.rowWord(y, wordInRow);
+            if (cleared != 0) {
+                writeRowWord(y, wordInRow, cleared, 0);
+            }
+            for (uint32_t bits = cleared; bits != 0; bits &= bits - 1) {
+                onCleared(wordInRow * bitsPerWord + __builtin_ctz(bits));
+            }
+        }
+    }
+
+    /**
+     * @brief Sets all the bits of a span.
+     *
+     * Works a whole storage word at a time.
+     *
+     * @param [in] y: The row of the span, 0 <= y < Y.
+     *
+     * @param [in] x0: The first x coordinate of the span.
+     *
+     * @param [in] x1: The last x coordinate of the span (inclusive), x0 <= x1 < X.
+     */
+    void fillSpan(int y, int x0, int x1) {
+        for (int wordInRow = x0 / bitsPerWord; wordInRow <= x1 / bitsPerWord; ++wordInRow) {
+            writeRowWord(y, wordInRow, spanMask(wordInRow, x0, x1), ~uint32_t(0));
+        }
+    }
+
+    /**
+     * @brief Clears all the bits of a span.
+     *
+     * Works a whole storage word at a time.
+     *
+     * @param [in] y: The row of the span, 0 <= y < Y.
+     *
+     * @param [in] x0: The first x coordinate of the span.
+     *
+     * @param [in] x1: The last x coordinate of the span (inclusive), x0 <= x1 < X.
+     */
+    void clearSpan(int y, int x0, int x1) {
+        for (int wordInRow = x0 / bitsPerWord; wordInRow <= x1 / bitsPerWord; ++wordInRow) {
+            writeRowWord(y, wordInRow, spanMask(wordInRow, x0, x1), 0);
+        }
+    }
+
+    /**
+     * @brief Sets all the bits of a rectangle.
+     *
+     * The corners are inclusive, and have to be within the grid.
+     */
+    void fillRect(int x0, int y0, int x1, int y1) {
+        for (int y = y0; y <= y1; ++y) {
+            fillSpan(y, x0, x1);
+        }
+    }
+
+    /**
+     * @brief Clears all the bits of a rectangle.
+     *
+     * The corners are inclusive, and have to be within the grid.
+     */
+    void clearRect(int x0, int y0, int x1, int y1) {
+        for (int y = y0; y <= y1; ++y) {
+            clearSpan(y, x0, x1);
+        }
+    }
+
+    /**
+     * @brief Reads up to 32 consecutive bits of a row.
+     *
+     * @param [in] x: The x coordinate of the first bit.
+     *
+     * @param [in] y: The row, 0 <= y < Y.
+     *
+     * @param [in] count: The amount of bits, 1 <= count <= 32 and x + count <= X.
+     *
+     * @return [uint32_t] - The bits, the first one in the least significant bit.
+     */
+    uint32_t readBits(int x, int y, int count) const {
+        const int wordInRow = x / bitsPerWord;
+        const int shift = x % bitsPerWord;
+        uint64_t bits = rowWord(y, wordInRow) >> shift;
+        if (shift + count > bitsPerWord) {
+            bits |= uint64_t(rowWord(y, wordInRow + 1)) << (bitsPerWord - shift);
+        }
+        return uint32_t(bits) & lowMask(count);
+    }
+
+    /**
+     * @brief Writes up to 32 consecutive bits of a row.
+     *
+     * @param [in] x: The x coordinate of the first bit.
+     *
+     * @param [in] y: The row, 0 <= y < Y.
+     *
+     * @param [in] count: The amount of bits, 1 <= count <= 32 and x + count <= X.
+     *
+     * @param [in] bits: The bits, the first one in the least significant bit.
+     *
+     * @param [in] operation: How the bits are written.
+     */
+    void writeBits(int x, int y, int count, uint32_t bits, BitOperation operation) {
+        const int wordInRow = x / bitsPerWord;
+        const int shift = x % bitsPerWord;
+        bits &= lowMask(count);
+        applyToRowWord(y, wordInRow, lowMask(count) << shift, bits << shift, operation);
+        if (shift + count > bitsPerWord) {
+            const int remaining = shift + count - bitsPerWord;
+            applyToRowWord(y, wordInRow + 1, lowMask(remaining), bits >> (bitsPerWord - shift), operation);
+        }
+    }
+
+    /**
+     * @brief Copies a rectangle of bits from another grid.
+     *
+     * The bits are moved 32 at a time. The source can be this grid,
+     * the regions are allowed to overlap. The regions have to be
+     * within the grids. The grids do not need to have the same layout.
+     *
+     * @param [in] source: The grid to copy from.
+     *
+     * @param [in] sourceX: The left side of the region in the source.
+     *
+     * @param [in] sourceY: The top side of the region in the source.
+     *
+     * @param [in] width: The width of the region.
+     *
+     * @param [in] height: The height of the region.
+     *
+     * @param [in] x: The left side of the destination.
+     *
+     * @param [in] y: The top side of the destination.
+     *
+     * @param [in] operation: How the bits are written.
+     */
+    template <int SX, int SY, class SourceLayout>
+    void copyRegion(const BitGrid<SX, SY, SourceLayout> &source, int sourceX, int sourceY, int width, int height, int x, int y,
+                    BitOperation operation = BitOperation::COPY) {
+        const bool bottomUp = static_cast<const void *>(&source) == this && y > sourceY;
+        for (int i = 0; i < height; ++i) {
+            const int row = bottomUp ? height - 1 - i : i;
+            copyRow(source, sourceX, sourceY + row, width, x, y + row, operation);
+        }
+    }
+
+    /**
+     * @brief Copies a part of a row from another grid, see copyRegion().
+     */
+    template <int SX, int SY, class SourceLayout>
+    void copyRow(const BitGrid<SX, SY, SourceLayout> &source, int sourceX, int sourceY, int width, int x, int y,
+                 BitOperation operation) {
+        ///< The whole part is read first, so it may overlap with the destination.
+        std::array<uint32_t, BitGrid<SX, SY, SourceLayout>::wordsPerRow> buffer;
+        for (int offset = 0; offset < width; offset += bitsPerWord) {
+            const int count = width - offset < bitsPerWord ? width - offset : bitsPerWord;
+            buffer[offset / bitsPerWord] = source.readBits(sourceX + offset, sourceY, count);
+        }
+        for (int offset = 0; offset < width; offset += bitsPerWord) {
+            const int count = width - offset < bitsPerWord ? width - offset : bitsPerWord;
+            writeBits(x + offset, y, count, buffer[offset / bitsPerWord], operation);
+        }
+    }
+
+    /**
+     * @brief Clears all the bits.
+     */
+    void clear() {
+        words.fill(0);
+    }
+
+    /**
+     * @brief Calls a function for every set bit.
+     *
+     * Words without set bits are skipped as a whole, and the set bits
+     * within a word are found with count-trailing-zeros. The bits are
+     * visited row by row.
+     *
+     * @param [in] function: Called as function(x, y) for every set bit.
+     */
+    template <class F>
+    void forEachSet(F function) const {
+        for (int y = 0; y < Y; ++y) {
+            for (int wordInRow = 0; wordInRow < wordsPerRow; ++wordInRow) {
+                for (uint32_t word = rowWord(y, wordInRow); word != 0; word &= word - 1) {
+                    function(wordInRow * bitsPerWord + __builtin_ctz(word), y);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the set bits, for use in a range-based for loop.
+     *
+     * for (auto point : grid.setBits()) visits every set bit, see SetBitIterator.
+     */
+    SetBitRange<BitGrid> setBits() const {
+        return SetBitRange<BitGrid>(*this, 0, 0, X - 1, Y - 1);
+    }
+
+    /**
+     * @brief Returns the set bits of a rectangle, for use in a range-based for loop.
+     *
+     * The corners are inclusive, and have to be within the grid.
+     */
+    SetBitRange<BitGrid> setBits(int x0, int y0, int x1, int y1) const {
+        return SetBitRange<BitGrid>(*this, x0, y0, x1, y1);
+    }
+
+    /**
+     * @brief Returns the amount of set bits.
+     *
+     * Counts a whole storage word at a time.
+     */
+    int count() const {
+        int result = 0;
+        for (auto word : words) {
+            result += __builtin_popcount(word);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the amount of set bits in a rectangle.
+     *
+     * Counts a whole storage word at a time. The corners are
+     * inclusive, and have to be within the grid.
+     */
+    int count(int x0, int y0, int x1, int y1) const {
+        int result = 0;
+        for (int y = y0; y <= y1; ++y) {
+            for (int wordInRow = x0 / bitsPerWord; wordInRow <= x1 / bitsPerWord; ++wordInRow) {
+                result += __builtin_popcount(rowWord(y, wordInRow) & spanMask(wordInRow, x0, x1));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns 32 bits of a row.
+     *
+     * Bit i of the result is the bit of grid point
+     * (32 * wordInRow + i, y). Bits past the end of the
+     * row are 0.
+     *
+     * @param [in] y: The row, 0 <= y < Y.
+     *
+     * @param [in] wordInRow: The index of the word in the row, 0 <= wordInRow < wordsPerRow.
+     *
+     * @return [uint32_t] - The bits.
+     */
+    uint32_t getRowWord(int y, int wordInRow) const {
+        return rowWord(y, wordInRow);
+    }
+
+    /**
+     * @brief Returns which of the 8 neighbors of a point are set.
+     *
+     * Bit i of the result is the neighbor at offset (Neighborhood::offsetX[i],
+     * Neighborhood::offsetY[i]). Neighbors outside of the grid are 0. Away
+     * from the border the neighbors are gathered from the storage words
+     * that hold them, instead of point by point.
+     *
+     * @param [in] x: The x coordinate, 0 <= x < X.
+     *
+     * @param [in] y: The y coordinate, 0 <= y < Y.
+     *
+     * @return [uint32_t] - The neighbors.
+     */
+    uint32_t getNeighborhood(int x, int y) const {
+        if (x >= 1 && x + 1 < X && y >= 1 && y + 1 < Y) {
+            ///< The neighbors are read 3 at a time: from the row above, the row itself and the row below.
+            const uint32_t middle = Storage::readTriple(words.data(), x - 1, y);
+            return Storage::readTriple(words.data(), x - 1, y - 1) | (middle & 1) << 3 | (middle & 4) << 2 |
+                   Storage::readTriple(words.data(), x - 1, y + 1) << 5;
+        }
+        uint32_t result = 0;
+        for (int i = 0; i < Neighborhood::size; ++i) {
+            const int nx = x + Neighborhood::offsetX[i];
+            const int ny = y + Neighborhood::offsetY[i];
+            if (nx >= 0 && nx < X && ny >= 0 && ny < Y && get(nx, ny)) {
+                result |= uint32_t(1) << i;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns a storage word.
+     *
+     * Which points a storage word holds depends on the layout.
+     *
+     * @param [in] index: The index of the word, 0 <= index < wordCount.
+     *
+     * @return [uint32_t] - The word.
+     */
+    uint32_t getWord(int index) const {
+        return words[index];
+    }
+
+    /**
+     * @brief Overwrites a storage word.
+     *
+     * The bits past the end of a row have to stay 0.
+     *
+     * @param [in] index: The index of the word, 0 <= index < wordCount.
+     *
+     * @param [in] word: The new value of the word.
+     */
+    void setWord(int index, uint32_t word) {
+        words[index] = word;
+    }
+};
+
+template <class Source>
+constexpr int SetBitIterator<Source>::bitsPerWord;
+
+template <int X, int Y>
+constexpr int GridLayout<RowMajorLayout, X, Y>::wordsPerRow;
+
+template <int X, int Y>
+constexpr int GridLayout<RowMajorLayout, X, Y>::wordCount;
+
+template <int X, int Y>
+constexpr int GridLayout<MortonLayout, X, Y>::tilesPerRow;
+
+template <int X, int Y>
+constexpr int GridLayout<MortonLayout, X, Y>::wordCount;
+
+template <int X, int Y, class Layout>
+constexpr int BitGrid<X, Y, Layout>::width;
+
+template <int X, int Y, class Layout>
+constexpr int BitGrid<X, Y, Layout>::height;
+
+template <int X, int Y, class Layout>
+constexpr int BitGrid<X, Y, Layout>::bitsPerWord;
+
+template <int X, int Y, class Layout>
+constexpr int BitGrid<X, Y, Layout>::wordsPerRow;
+
+template <int X, int Y, class Layout>
+constexpr int BitGrid<X, Y, Layout>::wordCount;
+
+template <int X, int Y, class Layout>
+constexpr int BitGrid<X, Y, Layout>::tileSize;
+
+template <int X, int Y, class Layout>
+constexpr int BitGrid<X, Y, Layout>::tilesPerRow;
+
+template <int X, int Y, class Layout>
+constexpr int BitGrid<X, Y, Layout>::tileCount;
+} // namespace Mapping
+
+#endif // BITGRID_HPP
@@ -0,0 +1,261 @@
+/**
+ * @file
+ * @brief     Frontier detector class
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef FRONTIER_HPP
+#define FRONTIER_HPP
+
+#include "bitgrid.hpp"
+#include "vector2d.hpp"
+#include <array>
+
+namespace Mapping {
+/**
+ * @brief A cluster of frontier points, used as exploration target.
+ */
+struct FrontierTarget {
+    FrontierTarget() : centroid(0, 0), cellCount(0) {
+    }
+    Vector2D centroid; ///< The average position of the points in the cluster.
+    int cellCount;     ///< The amount of frontier points in the cluster.
+};
+
+/**
+ * @brief This class finds the frontiers of a Map2D.
+ *
+ * A frontier point is an explored grid point without an obstacle,
+ * that has at least one unknown neighbour (left, right, up or down).
+ * Driving to a frontier lets the robot explore the unknown space
+ * behind it.
+ *
+ * The set of frontier points is maintained incrementally: update()
+ * only looks at the points in the change log of the map and their
+ * neighbours. Only when the change log overflowed is the whole map
+ * scanned again.
+ *
+ * The frontier points can be clustered into targets (8-connected)
+ * with extractTargets().
+ *
+ * @tparam X: The width of the map.
+ * @tparam Y: The height of the map.
+ * @tparam MaxTargets: The maximum amount of targets that are extracted.
+ * @tparam StackCapacity: The size of the stack used for clustering. When
+ * a cluster needs a larger stack, it will be split into multiple targets.
+ */
+template <int X, int Y, int MaxTargets = 16, int StackCapacity = 2 * (X + Y)>
+class FrontierDetector {
+  private:
+    BitGrid<X, Y> frontier;
+    BitGrid<X, Y> visited;
+    int frontierCellCount;
+    std::array<FrontierTarget, MaxTargets> targets;
+    int targetCount;
+    std::array<int, StackCapacity> stack;
+    int stackSize;
+
+    static bool pointWithinMap(const Vector2D &point) {
+        return point.x >= 0 && point.x < X && point.y >= 0 && point.y < Y;
+    }
+
+    template <class MapType>
+    static bool isUnknown(const MapType &map, const Vector2D &point) {
+        return pointWithinMap(point) && !map.isExplored(point);
+    }
+
+    template <class MapType>
+    static bool hasUnknownNeighbour(const MapType &map, const Vector2D &point) {
+        return isUnknown(map, point + Vector2D(1, 0)) || isUnknown(map, point + Vector2D(-1, 0)) ||
+               isUnknown(map, point + Vector2D(0, 1)) || isUnknown(map, point + Vector2D(0, -1));
+    }
+
+    /**
+     * @brief Updates the frontier state of a single point.
+     *
+     * @param [in] map: The map to check the point in.
+     *
+     * @param [in] point: The point to update.
+     */
+    template <class MapType>
+    void evaluate(const MapType &map, const Vector2D &point) {
+        if (!pointWithinMap(point)) {
+            return;
+        }
+        const bool isFrontierPoint = map.isExplored(point) && !map.isObstacle(point) && hasUnknownNeighbour(map, point);
+        if (isFrontierPoint != frontier.get(point.x, point.y)) {
+            if (isFrontierPoint) {
+                frontier.set(point.x, point.y);
+                ++frontierCellCount;
+            } else {
+                frontier.reset(point.x, point.y);
+                --frontierCellCount;
+            }
+        }
+    }
+
+    /**
+     * @brief Updates a changed point and its neighbours.
+     *
+     * A change of a point can only change the frontier state
+     * of the point itself and its direct neighbours.
+     */
+    template <class MapType>
+    void evaluateAround(const MapType &map, const Vector2D &point) {
+        evaluate(map, point);
+        evaluate(map, point + Vector2D(1, 0));
+        evaluate(map, point + Vector2D(-1, 0));
+        evaluate(map, point + Vector2D(0, 1));
+        evaluate(map, point + Vector2D(0, -1));
+    }
+
+    void push(int x, int y) {
+        if (x < 0 || x >= X || y < 0 || y >= Y || stackSize == StackCapacity) {
+            return;
+        }
+        if (frontier.get(x, y) && !visited.get(x, y)) {
+            visited.set(x, y);
+            stack[stackSize++] = y * X + x;
+        }
+    }
+
+    /**
+     * @brief Collects the cluster that contains the seed point.
+     *
+     * @param [in] seed: A frontier point that is not visited yet.
+     *
+     * @return [FrontierTarget] - The cluster.
+     */
+    FrontierTarget growCluster(const Vector2D &seed) {
+        int sumX = 0;
+        int sumY = 0;
+        FrontierTarget target;
+        push(seed.x, seed.y);
+        while (stackSize > 0) {
+            const int x = stack[--stackSize] % X;
+            const int y = stack[stackSize] / X;
+            sumX += x;
+            sumY += y;
+            ++target.cellCount;
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    push(x + dx, y + dy);
+                }
+            }
+        }
+        target.centroid = Vector2D(sumX / target.cellCount, sumY / target.cellCount);
+        return target;
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * Constructs a detector without frontier points.
+     * Call update() to find the frontiers of a map.
+     */
+    FrontierDetector() : frontierCellCount(0), targetCount(0), stackSize(0) {
+    }
+
+    /**
+     * @brief Updates the frontier points after a sweep.
+     *
+     * Only the points in the change log of the map (and their
+     * neighbours) are checked. If the change log overflowed,
+     * rebuild() is used instead. Call this function after every
+     * sweep, before the next sweep starts.
+     *
+     * @param [in] map: The map that has been updated.
+     */
+    template <class MapType>
+    void update(const MapType &map) {
+        if (map.changedCellsOverflowed()) {
+            rebuild(map);
+            return;
+        }
+        for (int i = 0; i < map.getChangedCellCount(); ++i) {
+            evaluateAround(map, map.getChangedCell(i));
+        }
+    }
+
+    /**
+     * @brief Finds all frontier points by scanning the whole map.
+     *
+     * @param [in] map: The map to scan.
+     */
+    template <class MapType>
+    void rebuild(const MapType &map) {
+        frontier.clear();
+        frontierCellCount = 0;
+        for (int y = 0; y < Y; ++y) {
+            for (int x = 0; x < X; ++x) {
+                evaluate(map, Vector2D(x, y));
+            }
+        }
+    }
+
+    /**
+     * @brief Returns if the point is a frontier point.
+     *
+     * @param [in] point: The point to check.
+     *
+     * @return [bool] - True if the point is within the map and a frontier point.
+     */
+    bool isFrontier(const Vector2D &point) const {
+        return pointWithinMap(point) && frontier.get(point.x, point.y);
+    }
+
+    /**
+     * @brief Returns the amount of frontier points.
+     */
+    int getFrontierCellCount() const {
+        return frontierCellCount;
+    }
+
+    /**
+     * @brief Clusters the frontier points into targets.
+     *
+     * Frontier points that touch each other (also diagonally)
+     * belong to the same target. Clusters that are smaller than
+     * minCellCount are ignored. At most MaxTargets targets are
+     * extracted, the rest is ignored.
+     *
+     * @param [in] minCellCount: The minimum size of a target.
+     *
+     * @return [int] - The amount of extracted targets.
+     */
+    int extractTargets(int minCellCount = 1) {
+        visited.clear();
+        targetCount = 0;
+        frontier.forEachSet([this, minCellCount](int x, int y) {
+            if (visited.get(x, y) || targetCount == MaxTargets) {
+                return;
+            }
+            auto target = growCluster(Vector2D(x, y));
+            if (target.cellCount >= minCellCount) {
+                targets[targetCount++] = target;
+            }
+        });
+        return targetCount;
+    }
+
+    /**
+     * @brief Returns the amount of targets found by extractTargets().
+     */
+    int getTargetCount() const {
+        return targetCount;
+    }
+
+    /**
+     * @brief Returns a target found by extractTargets().
+     *
+     * @param [in] index: The index of the target, 0 <= index < getTargetCount().
+     */
+    const FrontierTarget &getTarget(int index) const {
+        return targets[index];
+    }
+};
+} // namespace Mapping
+
+#endif // FRONTIER_HPP
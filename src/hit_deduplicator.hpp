@@ -0,0 +1,232 @@
+/**
+ * @file
+ * @brief     Per-cell hit deduplication class
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef HIT_DEDUPLICATOR_HPP
+#define HIT_DEDUPLICATOR_HPP
+
+#include "angle.hpp"
+#include "instrumentation.hpp"
+#include "vector2d.hpp"
+#include <array>
+#include <stdint.h>
+
+namespace Mapping {
+/**
+ * @brief This class collapses repeated measurements of the same grid point
+ * into a single update of a Map2D.
+ *
+ * A dense sweep returns many measurements that end on the same grid
+ * point, and from the same sensor position those all trace the same ray.
+ * The deduplicator projects every measurement to its grid point and
+ * stages the point in a small open-addressing hash set with a hit count.
+ * flush() then adds every distinct point to the map once, in the order
+ * of their first hit, so the insertion work scales with the distinct
+ * points instead of with the measurements.
+ *
+ * The map ends up the same as with map.addMeasurement() for every
+ * measurement, change log included, as long as everything is flushed
+ * before the map is read. The staged points are flushed by themselves
+ * when the sensor moves to another grid point (its rays would change)
+ * and when the set is 3/4 full.
+ *
+ * The instrumentation of the map counts the distinct points as inserted.
+ *
+ * @tparam MapType: The type of the map, a Map2D.
+ * @tparam Capacity: The amount of slots of the hash set, a power of 2.
+ */
+template <class MapType, int Capacity = 256>
+class HitDeduplicator {
+    static_assert(Capacity >= 4 && (Capacity & (Capacity - 1)) == 0, "The capacity has to be a power of 2");
+    static_assert(Capacity <= 65536, "The slots are indexed with 16 bits");
+
+  private:
+    ///< The amount of staged points that triggers a flush, to keep the probe sequences short.
+    static constexpr int flushThreshold = Capacity / 4 * 3;
+
+    MapType &map;
+    ///< The coordinates of the staged points, which can be outside of the map.
+    std::array<int, Capacity> xs;
+    std::array<int, Capacity> ys;
+    ///< The hits of the staged points, 0 for an empty slot.
+    std::array<uint16_t, Capacity> hits;
+    ///< The slots in use, in the order of the first hit.
+    std::array<uint16_t, flushThreshold> order;
+    int stagedCount;
+    Vector2D stagedSensor;
+    uint32_t samples;
+    uint32_t distinctPoints;
+    uint32_t flushes;
+
+    /**
+     * @brief Returns the home slot of a point (Fibonacci hashing, from the middle bits).
+     */
+    static int homeSlot(const Vector2D &point) {
+        const uint32_t key = uint32_t(point.x) ^ (uint32_t(point.y) * 0x85EBCA6Bu);
+        return int(((key * 2654435769u) >> 16) & uint32_t(Capacity - 1));
+    }
+
+    /**
+     * @brief Stages a hit of a point.
+     */
+    void stage(const Vector2D &point) {
+        int slot = homeSlot(point);
+        while (hits[slot] != 0 && (xs[slot] != point.x || ys[slot] != point.y)) {
+            slot = (slot + 1) & (Capacity - 1);
+        }
+        if (hits[slot] == 0) {
+            xs[slot] = point.x;
+            ys[slot] = point.y;
+            order[stagedCount++] = uint16_t(slot);
+            ++distinctPoints;
+        }
+        if (hits[slot] != UINT16_MAX) {
+            ++hits[slot];
+        }
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * @param [in] map: The map to insert into. It has to outlive this object.
+     */
+    explicit HitDeduplicator(MapType &map)
+        : map(map), stagedCount(0), stagedSensor(0, 0), samples(0), distinctPoints(0), flushes(0) {
+        hits.fill(0);
+    }
+
+    HitDeduplicator(const HitDeduplicator &) = delete;
+    HitDeduplicator &operator=(const HitDeduplicator &) = delete;
+
+    /**
+     * @brief Stages a measurement, see Map2D::addMeasurement().
+     *
+     * @param [in] angle: The angle of the measurement, relative
+     * to the rotation of the sensor.
+     *
+     * @param [in] distance: The measured distance in centimeters.
+     */
+    void addMeasurement(Angle angle, double distance) {
+        if (MapType::ConfigType::maxRange > 0 && distance >= MapType::ConfigType::maxRange) {
+            return;
+        }
+        const Vector2D sensor = map.getSensorPosition();
+        if (stagedCount > 0 && !(sensor == stagedSensor)) {
+            flush();
+        }
+        stagedSensor = sensor;
+        ++samples;
+        stage(map.projectMeasurement(angle, distance));
+        if (stagedCount == flushThreshold) {
+            flush();
+        }
+    }
+
+    /**
+     * @brief Adds every staged point to the map once, and empties the set.
+     *
+     * @param [in] onPoint: Called as onPoint(point, hits) for every
+     * distinct point before it is added, for example to weigh obstacles
+     * by their hits. The hits saturate at 65535.
+     */
+    template <class F>
+    void flush(F onPoint) {
+        for (int i = 0; i < stagedCount; ++i) {
+            const int slot = order[i];
+            const Vector2D point(xs[slot], ys[slot]);
+            onPoint(point, int(hits[slot]));
+            map.addProjectedMeasurement(stagedSensor, point);
+            hits[slot] = 0;
+        }
+        if (stagedCount > 0) {
+            ++flushes;
+        }
+        stagedCount = 0;
+    }
+
+    /**
+     * @brief Adds every staged point to the map once, and empties the set.
+     */
+    void flush() {
+        flush([](const Vector2D &, int) {});
+    }
+
+    /**
+     * @brief Flushes the staged points, and starts a new sweep of the map.
+     *
+     * Use this instead of Map2D::beginSweep(), so the staged points
+     * end up in the sweep they were measured in.
+     */
+    void beginSweep() {
+        flush();
+        map.beginSweep();
+    }
+
+    /**
+     * @brief Returns the amount of staged points.
+     */
+    int getStagedCount() const {
+        return stagedCount;
+    }
+
+    /**
+     * @brief Returns the amount of measurements that were staged.
+     */
+    uint32_t getSampleCount() const {
+        return samples;
+    }
+
+    /**
+     * @brief Returns the amount of points that were added to the map.
+     */
+    uint32_t getDistinctCount() const {
+        return distinctPoints;
+    }
+
+    /**
+     * @brief Returns the measurements per added point, 1 when nothing was collapsed.
+     */
+    double getDeduplicationRatio() const {
+        return distinctPoints == 0 ? 1.0 : double(samples) / distinctPoints;
+    }
+
+    /**
+     * @brief Sets the counters to 0.
+     */
+    void resetCounters() {
+        samples = 0;
+        distinctPoints = 0;
+        flushes = 0;
+    }
+
+    /**
+     * @brief Writes the counters as a line of text.
+     *
+     * For example:
+     *
+     *     dedup smp=720 pts=180 fl=2
+     *
+     * The deduplication ratio is smp / pts.
+     *
+     * @param [in] sink: Called as sink(character) for every character,
+     * see MapInstrumentation::dump().
+     */
+    template <class Sink>
+    void dump(Sink sink) const {
+        InstrumentationDump::writeText(sink, "dedup");
+        InstrumentationDump::writeField(sink, "smp", samples);
+        InstrumentationDump::writeField(sink, "pts", distinctPoints);
+        InstrumentationDump::writeField(sink, "fl", flushes);
+        sink('\n');
+    }
+};
+
+template <class MapType, int Capacity>
+constexpr int HitDeduplicator<MapType, Capacity>::flushThreshold;
+} // namespace Mapping
+
+#endif // HIT_DEDUPLICATOR_HPP
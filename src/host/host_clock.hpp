@@ -0,0 +1,29 @@
+/**
+ * @file
+ * @brief     Cycle counter that uses the clock of the host (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef HOST_CLOCK_HPP
+#define HOST_CLOCK_HPP
+
+#include <chrono>
+#include <stdint.h>
+
+namespace Mapping {
+/**
+ * @brief A cycle counter for MapInstrumentation that counts nanoseconds.
+ *
+ * The counter wraps around about every 4 seconds, which is fine for
+ * measuring durations shorter than that.
+ */
+struct HostCycleCounter {
+    static uint32_t now() {
+        const auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+        return uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+};
+} // namespace Mapping
+
+#endif // HOST_CLOCK_HPP
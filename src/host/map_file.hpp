@@ -0,0 +1,356 @@
+/**
+ * @file
+ * @brief     Map file format, writer and memory mapped view (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef MAP_FILE_HPP
+#define MAP_FILE_HPP
+
+#include "../angle.hpp"
+#include "../bitgrid.hpp"
+#include "../vector2d.hpp"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace Mapping {
+/**
+ * @brief The types of payload a map file can contain.
+ */
+enum class MapPayload : uint8_t {
+    BIT_PACKED = 0, ///< 1 bit per grid point, set when it is an obstacle.
+    LOG_ODDS = 1    ///< 1 signed byte per grid point, an obstacle when > 0.
+};
+
+/**
+ * @brief The header at the start of every map file.
+ *
+ * A map file starts with this header, followed by the payload at
+ * payloadOffset. The payload is stored row by row (rows have the same
+ * y coordinate), every row takes rowStride bytes, which is a multiple of 8.
+ * In a bit-packed payload, grid point x of a row is bit x % 8 of byte x / 8.
+ * The header is stored as is, so its values are in the byte order of the
+ * host that wrote the file. A file from a host with the other byte order
+ * is rejected when it is opened, as its headerSize does not match.
+ */
+struct MapFileHeader {
+    char magic[4];            ///< "R2MP"
+    uint16_t version;         ///< The version of the format, see MapFileHeader::currentVersion.
+    uint16_t headerSize;      ///< sizeof(MapFileHeader)
+    uint32_t width;           ///< The size of the map in the x direction.
+    uint32_t height;          ///< The size of the map in the y direction.
+    uint32_t rowStride;       ///< The amount of bytes per row in the payload.
+    uint8_t payload;          ///< A MapPayload value.
+    uint8_t subCellBits;      ///< The amount of fractional bits of the sensor position.
+    uint16_t reserved;        ///< Always 0.
+    uint64_t payloadOffset;   ///< The position of the payload in the file.
+    double scale;             ///< The amount of centimeters a grid point represents.
+    int32_t sensorX;          ///< The x position of the sensor, in sub-cell units.
+    int32_t sensorY;          ///< The y position of the sensor, in sub-cell units.
+    double sensorAngleDegree; ///< The rotation of the sensor.
+    uint8_t padding[8];       ///< Always 0, pads the header to 64 bytes.
+
+    static constexpr uint16_t currentVersion = 1;
+};
+
+static_assert(sizeof(MapFileHeader) == 64, "The map file header has to be exactly 64 bytes");
+
+namespace MapFile {
+/**
+ * @brief Returns the row stride for a map width and payload type.
+ */
+inline uint32_t rowStride(uint32_t width, MapPayload payload) {
+    const uint32_t bytes = payload == MapPayload::BIT_PACKED ? (width + 7) / 8 : width;
+    return (bytes + 7) / 8 * 8;
+}
+
+/**
+ * @brief Fills in a header for the given map.
+ */
+template <class MapType, int X, int Y, class Layout>
+MapFileHeader createHeader(const MapType &map, const BitGrid<X, Y, Layout> &, MapPayload payload) {
+    MapFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "R2MP", 4);
+    header.version = MapFileHeader::currentVersion;
+    header.headerSize = sizeof(MapFileHeader);
+    header.width = X;
+    header.height = Y;
+    header.rowStride = rowStride(X, payload);
+    header.payload = uint8_t(payload);
+    header.subCellBits = MapType::subCellBits;
+    header.payloadOffset = sizeof(MapFileHeader);
+    header.scale = map.getScale();
+    header.sensorX = map.getSensorSubCellPosition().x;
+    header.sensorY = map.getSensorSubCellPosition().y;
+    header.sensorAngleDegree = map.getSensorRotation().asDegree();
+    return header;
+}
+
+/**
+ * @brief Writes a header and the rows of a payload to a file.
+ *
+ * @param [in] row: Called as row(y, buffer) to fill the bytes of a row.
+ * The buffer is zeroed before every call.
+ */
+template <class RowWriter>
+bool write(const char *path, const MapFileHeader &header, RowWriter row) {
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    std::vector<uint8_t> buffer(header.rowStride);
+    for (uint32_t y = 0; success && y < header.height; ++y) {
+        memset(buffer.data(), 0, header.rowStride);
+        row(y, buffer.data());
+        success = fwrite(buffer.data(), header.rowStride, 1, file) == 1;
+    }
+    return fclose(file) == 0 && success;
+}
+} // namespace MapFile
+
+/**
+ * @brief Writes a map to a bit-packed map file.
+ *
+ * @param [in] path: The path of the file, which is overwritten.
+ *
+ * @param [in] map: The map to write.
+ *
+ * @return [bool] - True if the file was written successfully.
+ */
+template <class MapType>
+bool writeMapFile(const char *path, const MapType &map) {
+    const auto header = MapFile::createHeader(map, map.getGrid(), MapPayload::BIT_PACKED);
+    return MapFile::write(path, header, [&header, &map](uint32_t y, uint8_t *row) {
+        ///< The words of the map leave out the expired obstacles that are not yet removed.
+        for (uint32_t byte = 0; byte < (header.width + 7) / 8; ++byte) {
+            row[byte] = uint8_t(map.getRowWord(int(y), int(byte / 4)) >> (byte % 4 * 8));
+        }
+    });
+}
+
+/**
+ * @brief Writes a map with log-odds values to a map file.
+ *
+ * The pose and scale are taken from the map, the values
+ * of the grid points from the given function.
+ *
+ * @param [in] path: The path of the file, which is overwritten.
+ *
+ * @param [in] map: The map to take the pose and size from.
+ *
+ * @param [in] logOdds: Called as logOdds(x, y), returns the
+ * int8_t value of the grid point.
+ *
+ * @return [bool] - True if the file was written successfully.
+ */
+template <class MapType, class LogOdds>
+bool writeLogOddsMapFile(const char *path, const MapType &map, LogOdds logOdds) {
+    const auto header = MapFile::createHeader(map, map.getGrid(), MapPayload::LOG_ODDS);
+    return MapFile::write(path, header, [&header, &logOdds](uint32_t y, uint8_t *row) {
+        for (uint32_t x = 0; x < header.width; ++x) {
+            row[x] = uint8_t(logOdds(int(x), int(y)));
+        }
+    });
+}
+
+/**
+ * @brief This class gives read only access to a map file.
+ *
+ * The file is memory mapped, nothing is copied or parsed: opening
+ * a file only checks the header, and only the pages that are
+ * actually read are loaded from disk. The queries have the same
+ * meaning as the queries of Map2D.
+ */
+class MappedMapView {
+  private:
+    const uint8_t *data;
+    size_t size;
+
+    const MapFileHeader &header() const {
+        return *reinterpret_cast<const MapFileHeader *>(data);
+    }
+
+    const uint8_t *row(int y) const {
+        return data + header().payloadOffset + size_t(y) * header().rowStride;
+    }
+
+    bool headerValid() const {
+        if (size < sizeof(MapFileHeader) || memcmp(header().magic, "R2MP", 4) != 0) {
+            return false;
+        }
+        if (header().version != MapFileHeader::currentVersion || header().headerSize != sizeof(MapFileHeader) ||
+            header().subCellBits >= 31) {
+            return false;
+        }
+        ///< The payload may not overlap the header, nor start past the end of the file.
+        if (header().payloadOffset < sizeof(MapFileHeader) || header().payloadOffset > size) {
+            return false;
+        }
+        const auto payload = MapPayload(header().payload);
+        if ((payload != MapPayload::BIT_PACKED && payload != MapPayload::LOG_ODDS) ||
+            header().rowStride < MapFile::rowStride(header().width, payload)) {
+            return false;
+        }
+        return header().payloadOffset + uint64_t(header().rowStride) * header().height <= size;
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * Constructs a view without a file.
+     */
+    MappedMapView() : data(nullptr), size(0) {
+    }
+
+    MappedMapView(const MappedMapView &) = delete;
+    MappedMapView &operator=(const MappedMapView &) = delete;
+
+    ~MappedMapView() {
+        close();
+    }
+
+    /**
+     * @brief Opens a map file.
+     *
+     * @param [in] path: The path of the file.
+     *
+     * @return [bool] - True if the file is a valid map file. If not,
+     * the view is closed.
+     */
+    bool open(const char *path) {
+        close();
+        const int descriptor = ::open(path, O_RDONLY);
+        if (descriptor < 0) {
+            return false;
+        }
+        struct stat status;
+        if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+            void *mapping = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (mapping != MAP_FAILED) {
+                data = static_cast<const uint8_t *>(mapping);
+                size = size_t(status.st_size);
+            }
+        }
+        ::close(descriptor);
+        if (data != nullptr && !headerValid()) {
+            close();
+        }
+        return isOpen();
+    }
+
+    /**
+     * @brief Closes the file.
+     */
+    void close() {
+        if (data != nullptr) {
+            munmap(const_cast<uint8_t *>(data), size);
+        }
+        data = nullptr;
+        size = 0;
+    }
+
+    /**
+     * @brief Returns if a valid map file is open.
+     */
+    bool isOpen() const {
+        return data != nullptr;
+    }
+
+    /**
+     * @brief Returns the header of the open file.
+     */
+    const MapFileHeader &getHeader() const {
+        return header();
+    }
+
+    /**
+     * @brief Returns the size of the map in the x direction.
+     */
+    int getWidth() const {
+        return int(header().width);
+    }
+
+    /**
+     * @brief Returns the size of the map in the y direction.
+     */
+    int getHeight() const {
+        return int(header().height);
+    }
+
+    /**
+     * @brief Returns the amount of centimeters a grid point represents.
+     */
+    double getScale() const {
+        return header().scale;
+    }
+
+    /**
+     * @brief Returns the position of the sensor, in sub-cell units.
+     */
+    Vector2D getSensorSubCellPosition() const {
+        return Vector2D(header().sensorX, header().sensorY);
+    }
+
+    /**
+     * @brief Returns the grid point of the sensor.
+     */
+    Vector2D getSensorPosition() const {
+        ///< Rounded in 64 bits, as the position of a file can be anything up to INT32_MAX.
+        const int64_t half = (int64_t(1) << header().subCellBits) / 2;
+        return Vector2D(int((header().sensorX + half) >> header().subCellBits),
+                        int((header().sensorY + half) >> header().subCellBits));
+    }
+
+    /**
+     * @brief Returns the rotation of the sensor.
+     */
+    Angle getSensorRotation() const {
+        return Angle(AngleType::DEG, header().sensorAngleDegree);
+    }
+
+    /**
+     * @brief Returns if the point is in the map.
+     */
+    bool pointWithinMap(const Vector2D &point) const {
+        return point.x >= 0 && point.x < getWidth() && point.y >= 0 && point.y < getHeight();
+    }
+
+    /**
+     * @brief Returns the log-odds value of a point.
+     *
+     * For a bit-packed file, obstacles return 1 and other points -1.
+     *
+     * @param [in] point: The point, which has to be within the map.
+     */
+    int8_t getLogOdds(const Vector2D &point) const {
+        if (MapPayload(header().payload) == MapPayload::LOG_ODDS) {
+            return int8_t(row(point.y)[point.x]);
+        }
+        return (row(point.y)[point.x / 8] >> (point.x % 8)) & 1 ? 1 : -1;
+    }
+
+    /**
+     * @brief Returns if the point is an obstacle.
+     *
+     * @param [in] point: The point to check.
+     *
+     * @return [bool] - True if the point is within the map
+     * and an obstacle.
+     */
+    bool isObstacle(const Vector2D &point) const {
+        return pointWithinMap(point) && getLogOdds(point) > 0;
+    }
+};
+} // namespace Mapping
+
+#endif // MAP_FILE_HPP
@@ -0,0 +1,265 @@
+/**
+ * @file
+ * @brief     Tile-parallel scan insertion class (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef PARALLEL_INSERTION_HPP
+#define PARALLEL_INSERTION_HPP
+
+#include "../map2d.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+namespace Mapping {
+/**
+ * @brief This class adds many measurements to a Map2D at once, on a thread pool.
+ *
+ * The insertion runs in two parallel phases. First the measurement
+ * rays are walked in chunks of consecutive measurements, and every
+ * point they touch is binned by the band of tiles it lies in. Then
+ * every band is updated by a single task, which owns all points of
+ * the band, so no point needs a lock. A band is a whole row of tiles,
+ * because a storage word of the row-major layout spans several tiles
+ * of the same row (a Morton word stays within a tile).
+ *
+ * The result is identical to calling addMeasurement() for the
+ * measurements one by one: a band applies its points in the order
+ * of the measurements, and the change log and the tile write hook
+ * (see Map2D::setTileWriteHook()) are brought into that same order
+ * before they are used. The insertion latency of the instrumentation
+ * is not recorded, the counters are.
+ *
+ * @tparam MapType: The type of the map, a Map2D.
+ */
+template <class MapType>
+class ParallelScanInserter {
+  public:
+    /**
+     * @brief A single measurement, as given to Map2D::addMeasurement().
+     */
+    struct Measurement {
+        Angle angle;     ///< The angle, relative to the rotation of the sensor.
+        double distance; ///< The measured distance in centimeters.
+    };
+
+  private:
+    using GridType = typename MapType::GridType;
+
+    static constexpr int bandCount = (GridType::height + GridType::tileSize - 1) / GridType::tileSize;
+    ///< The step of the measured point itself, after all points of the ray.
+    static constexpr uint32_t endpointStep = 0xFFFFFF;
+
+    /**
+     * @brief A point that a measurement touches.
+     */
+    struct Event {
+        Vector2D point;
+        uint32_t measurement;
+        uint32_t step; ///< The index of the point on the ray, or endpointStep.
+    };
+
+    /**
+     * @brief Something that has to happen in the order of the measurements.
+     */
+    template <class T>
+    struct Ordered {
+        uint64_t key; ///< The measurement, the step and the index within the step.
+        T value;
+
+        bool operator<(const Ordered &other) const {
+            return key < other.key;
+        }
+    };
+
+    WorkStealingThreadPool &pool;
+    int chunkCount;
+    ///< The events of chunk c in band b are in bins[c * bandCount + b].
+    std::vector<std::vector<Event>> bins;
+    std::vector<int> inserted;
+    std::vector<int> rejected;
+    std::vector<std::vector<Ordered<Vector2D>>> changes;
+    ///< All changes of a band, also those that were not kept for the log.
+    std::vector<int> changeCounts;
+    std::vector<std::vector<Ordered<int>>> firstWrites;
+
+    static uint64_t orderKey(const Event &event, int index) {
+        return (uint64_t(event.measurement) << 32) | (uint64_t(event.step) << 8) | uint32_t(index);
+    }
+
+    /**
+     * @brief Walks the rays of a chunk of measurements, and bins the points.
+     */
+    void binChunk(const MapType &map, const std::vector<Measurement> &measurements, int chunk) {
+        const size_t begin = measurements.size() * chunk / chunkCount;
+        const size_t end = measurements.size() * (chunk + 1) / chunkCount;
+        const Vector2D sensor = MapType::toCell(map.sensorSubCellPosition);
+        std::vector<Event> *chunkBins = &bins[size_t(chunk) * bandCount];
+        for (size_t i = begin; i < end; ++i) {
+            const double distance = measurements[i].distance;
+            if (MapType::ConfigType::maxRange > 0 && distance >= MapType::ConfigType::maxRange) {
+                continue;
+            }
+            ++inserted[chunk];
+            const Vector2D point = map.calculateRelativePosition(map.sensorAngle + measurements[i].angle, distance);
+            uint32_t step = 0;
+            ///< Points that are explored already do not change, so they are left out.
+            MapType::walkRay(sensor, point, [&map, chunkBins, i, &step](const Vector2D &touched) {
+                if (!map.explored.get(touched.x, touched.y)) {
+                    chunkBins[touched.y / GridType::tileSize].push_back(Event{touched, uint32_t(i), step});
+                }
+                ++step;
+            });
+            if (MapType::pointWithinMap(point)) {
+                chunkBins[point.y / GridType::tileSize].push_back(Event{point, uint32_t(i), endpointStep});
+            } else {
+                ++rejected[chunk];
+            }
+        }
+    }
+
+    /**
+     * @brief Finds the first write of every tile of a band, in the order of the measurements.
+     *
+     * Every binned point writes its tile: a measured point always does, and
+     * the ray points that were explored already are not binned.
+     */
+    void findFirstWrites(int band) {
+        std::vector<bool> written(GridType::tilesPerRow, false);
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            for (const Event &event : bins[size_t(chunk) * bandCount + band]) {
+                const int tile = GridType::tileIndex(event.point.x, event.point.y);
+                if (!written[tile % GridType::tilesPerRow]) {
+                    written[tile % GridType::tilesPerRow] = true;
+                    firstWrites[band].push_back(Ordered<int>{orderKey(event, 0), tile});
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Applies the events of a band to the map, in the order of the measurements.
+     *
+     * The changes of a band come in order, so only the first ones that can
+     * still go in the change log (and one more, to detect an overflow) are
+     * kept.
+     */
+    void updateBand(MapType &map, int band, size_t logSpace) {
+        auto &bandChanges = changes[band];
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            for (const Event &event : bins[size_t(chunk) * bandCount + band]) {
+                int index = 0;
+                int &changeCount = changeCounts[band];
+                const auto record = [&bandChanges, &changeCount, &event, &index, logSpace](const Vector2D &changed) {
+                    ++changeCount;
+                    if (bandChanges.size() <= logSpace) {
+                        bandChanges.push_back(Ordered<Vector2D>{orderKey(event, index), changed});
+                    }
+                    ++index;
+                };
+                if (event.step == endpointStep) {
+                    map.markImpassable(event.point, record);
+                } else {
+                    map.markExplored(event.point, record);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Runs function(index) on the pool for every index in [0, count), and waits.
+     */
+    template <class F>
+    void runAll(int count, F function) {
+        for (int i = 0; i < count; ++i) {
+            pool.submit([&function, i]() { function(i); });
+        }
+        pool.wait();
+    }
+
+    template <class T>
+    static std::vector<T> mergeSorted(std::vector<std::vector<T>> &parts) {
+        std::vector<T> merged;
+        for (auto &part : parts) {
+            merged.insert(merged.end(), part.begin(), part.end());
+            part.clear();
+        }
+        std::sort(merged.begin(), merged.end());
+        return merged;
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * @param [in] pool: The thread pool to run on. It has to outlive this object.
+     *
+     * @param [in] chunksPerThread: The amount of chunks the measurements are split
+     * in per thread, to balance the work of walking the rays.
+     */
+    explicit ParallelScanInserter(WorkStealingThreadPool &pool, int chunksPerThread = 4)
+        : pool(pool), chunkCount(pool.getThreadCount() * chunksPerThread), bins(size_t(chunkCount) * bandCount),
+          inserted(chunkCount), rejected(chunkCount), changes(bandCount), changeCounts(bandCount), firstWrites(bandCount) {
+    }
+
+    ParallelScanInserter(const ParallelScanInserter &) = delete;
+    ParallelScanInserter &operator=(const ParallelScanInserter &) = delete;
+
+    /**
+     * @brief Adds measurements to the map.
+     *
+     * Gives the same map as map.addMeasurement(angle, distance) for
+     * every measurement, in order. The map may not be used by anything
+     * else until this returns.
+     *
+     * @param [in] map: The map.
+     *
+     * @param [in] measurements: The measurements, from the current sensor pose.
+     */
+    void addMeasurements(MapType &map, const std::vector<Measurement> &measurements) {
+        std::fill(inserted.begin(), inserted.end(), 0);
+        std::fill(rejected.begin(), rejected.end(), 0);
+        runAll(chunkCount, [this, &map, &measurements](int chunk) { binChunk(map, measurements, chunk); });
+        if (map.tileWriteHook != nullptr) {
+            runAll(bandCount, [this](int band) { findFirstWrites(band); });
+            for (const auto &write : mergeSorted(firstWrites)) {
+                map.beforeTileWrite(write.value);
+            }
+        }
+        const size_t logSpace = size_t(MapType::changeLogCapacity - map.changedCellCount);
+        std::fill(changeCounts.begin(), changeCounts.end(), 0);
+        runAll(bandCount, [this, &map, logSpace](int band) { updateBand(map, band, logSpace); });
+        const auto merged = mergeSorted(changes);
+        for (const auto &change : merged) {
+            map.recordChange(change.value);
+        }
+        ///< The changes that were not kept still count for the sweep.
+        for (int count : changeCounts) {
+            map.sweepChangeCount += count;
+        }
+        map.sweepChangeCount -= int(merged.size());
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            for (int i = 0; i < inserted[chunk]; ++i) {
+                map.instrumentation.pointInserted();
+            }
+            for (int i = 0; i < rejected[chunk]; ++i) {
+                map.instrumentation.pointRejected();
+            }
+        }
+        for (auto &bin : bins) {
+            bin.clear();
+        }
+    }
+};
+
+template <class MapType>
+constexpr int ParallelScanInserter<MapType>::bandCount;
+
+template <class MapType>
+constexpr uint32_t ParallelScanInserter<MapType>::endpointStep;
+} // namespace Mapping
+
+#endif // PARALLEL_INSERTION_HPP
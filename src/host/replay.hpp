@@ -0,0 +1,173 @@
+/**
+ * @file
+ * @brief     Parallel scan log replay engine (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include "../map2d.hpp"
+#include "scan_log.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace Mapping {
+/**
+ * @brief The mapping parameters of a single replay run.
+ */
+struct ReplayConfig {
+    double scale = 3;                ///< The amount of centimeters a grid point represents.
+    double minRange = 0;             ///< Measurements up to this distance (cm) are ignored.
+    double maxRange = 400;           ///< Measurements further than this distance (cm) are ignored.
+    uint32_t obstacleTimeToLive = 0; ///< The lifetime of obstacles in sweeps, 0 means forever.
+};
+
+/**
+ * @brief The throughput and map quality of a single replay run.
+ */
+struct ReplayResult {
+    ReplayConfig config;     ///< The configuration that was replayed.
+    int sweeps = 0;          ///< The amount of replayed sweeps.
+    long measurements = 0;   ///< The amount of measurements added to the map.
+    double seconds = 0;      ///< The time the replay took.
+    double sweepsPerSecond = 0;
+    int obstacleCells = 0;   ///< The amount of obstacle points in the final map.
+    int exploredCells = 0;   ///< The amount of explored points in the final map.
+    ///< The amount of sweeps whose pose was outside of the map. They were
+    ///< replayed from the previous position of the sensor.
+    int refusedPoses = 0;
+    ///< The fraction of measurements (after the first sweep) that ended on a point that was
+    ///< already an obstacle. A higher value means the map explains the measurements better.
+    double endpointAgreement = 0;
+};
+
+/**
+ * @brief This class replays a recorded scan log into maps.
+ *
+ * Every configuration is replayed into its own Map2D, so many
+ * configurations can run at the same time on a thread pool. The
+ * log itself is shared (read only) between all runs.
+ *
+ * @tparam X: The width of the maps.
+ * @tparam Y: The height of the maps.
+ */
+template <int X, int Y>
+class ReplayEngine {
+  private:
+    using MapType = Map2D<X, Y>;
+
+    const std::vector<ScanRecord> &log;
+    Vector2D origin;
+
+    struct Counters {
+        long measurements = 0;
+        long checked = 0;
+        long agreed = 0;
+        int refusedPoses = 0;
+    };
+
+    /**
+     * @brief Moves the sensor to the pose of a sweep.
+     *
+     * @return [bool] - False if the map refused the position.
+     */
+    bool placeSensor(MapType &map, const ScanRecord &record, const ReplayConfig &config) const {
+        const auto target = origin * MapType::subCellsPerCell +
+                            Vector2D(math::round(record.x * MapType::subCellsPerCell / config.scale),
+                                     math::round(record.y * MapType::subCellsPerCell / config.scale));
+        map.moveSensorSubCells(target - map.getSensorSubCellPosition());
+        map.setSensorRotation(Angle(AngleType::DEG, record.angleDegree));
+        return map.getSensorSubCellPosition() == target;
+    }
+
+    void replaySweep(MapType &map, const ScanRecord &record, const ReplayConfig &config, bool check, Counters &counters) const {
+        map.beginSweep();
+        for (int i = 0; i < ScanRecord::samplesPerSweep; ++i) {
+            const double distance = record.distances[i];
+            if (distance <= config.minRange || distance > config.maxRange) {
+                continue;
+            }
+            const Angle angle(AngleType::DEG, i);
+            if (check) {
+                ++counters.checked;
+                counters.agreed += map.isObstacle(map.projectMeasurement(angle, distance));
+            }
+            map.addMeasurement(angle, distance);
+            ++counters.measurements;
+        }
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * @param [in] log: The recorded sweeps. The vector has to stay
+     * alive and unchanged while the engine is used.
+     *
+     * @param [in] origin: The grid point of position (0, 0) of the log.
+     */
+    ReplayEngine(const std::vector<ScanRecord> &log, Vector2D origin = Vector2D(X / 2, Y / 2)) : log(log), origin(origin) {
+    }
+
+    /**
+     * @brief Replays the log with a single configuration.
+     *
+     * @param [in] config: The configuration.
+     *
+     * @return [ReplayResult] - The result of the replay.
+     */
+    ReplayResult replay(const ReplayConfig &config) const {
+        std::unique_ptr<MapType> map(new MapType(origin, Angle(), config.scale));
+        map->setObstacleTimeToLive(config.obstacleTimeToLive);
+        Counters counters;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t sweep = 0; sweep < log.size(); ++sweep) {
+            map->tick(uint32_t(sweep));
+            counters.refusedPoses += !placeSensor(*map, log[sweep], config);
+            replaySweep(*map, log[sweep], config, sweep > 0, counters);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        ReplayResult result;
+        result.config = config;
+        result.sweeps = int(log.size());
+        result.measurements = counters.measurements;
+        result.seconds = elapsed.count();
+        result.sweepsPerSecond = result.seconds > 0 ? result.sweeps / result.seconds : 0;
+        result.endpointAgreement = counters.checked > 0 ? double(counters.agreed) / counters.checked : 0;
+        result.obstacleCells = map->occupiedCount();
+        result.exploredCells = map->exploredCount();
+        result.refusedPoses = counters.refusedPoses;
+        return result;
+    }
+
+    /**
+     * @brief Replays the log with many configurations at the same time.
+     *
+     * Every configuration is a task on the thread pool. This function
+     * returns when all of them are finished.
+     *
+     * @param [in] configs: The configurations.
+     *
+     * @param [in] pool: The thread pool to run the replays on.
+     *
+     * @return [std::vector<ReplayResult>] - The results, in the same
+     * order as the configurations.
+     */
+    std::vector<ReplayResult> run(const std::vector<ReplayConfig> &configs, WorkStealingThreadPool &pool) const {
+        std::vector<ReplayResult> results(configs.size());
+        for (size_t i = 0; i < configs.size(); ++i) {
+            pool.submit([this, &configs, &results, i]() { results[i] = replay(configs[i]); });
+        }
+        pool.wait();
+        return results;
+    }
+};
+} // namespace Mapping
+
+#endif // REPLAY_HPP
@@ -0,0 +1,94 @@
+/**
+ * @file
+ * @brief     Recorded scan log format (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef SCAN_LOG_HPP
+#define SCAN_LOG_HPP
+
+#include <array>
+#include <stdio.h>
+#include <vector>
+
+namespace Mapping {
+/**
+ * @brief A single recorded sweep: the pose of the sensor and its measurements.
+ */
+struct ScanRecord {
+    ///< The amount of measurements in a sweep, 1 per degree.
+    static constexpr int samplesPerSweep = 360;
+
+    double x;           ///< The x position of the sensor in centimeters.
+    double y;           ///< The y position of the sensor in centimeters.
+    double angleDegree; ///< The rotation of the sensor.
+    ///< The measured distance in centimeters for every degree, relative
+    ///< to the rotation of the sensor. A distance <= 0 means no return.
+    std::array<float, samplesPerSweep> distances;
+};
+
+/**
+ * @brief Reads a scan log.
+ *
+ * A scan log is a text file with one sweep per line: the x and y
+ * position and the rotation of the sensor, followed by the 360
+ * measured distances, all separated by whitespace.
+ *
+ * @param [in] path: The path of the log.
+ *
+ * @param [out] records: The sweeps are appended to this vector.
+ *
+ * @return [bool] - True if the whole file was read. False when
+ * a line could not be read, for example a sweep that was cut off;
+ * the sweeps before it are still appended.
+ */
+inline bool loadScanLog(const char *path, std::vector<ScanRecord> &records) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    ScanRecord record;
+    while (fscanf(file, "%lf %lf %lf", &record.x, &record.y, &record.angleDegree) == 3) {
+        int i = 0;
+        while (i < ScanRecord::samplesPerSweep && fscanf(file, "%f", &record.distances[i]) == 1) {
+            ++i;
+        }
+        if (i < ScanRecord::samplesPerSweep) {
+            ///< A cut off sweep is dropped, and the file is not complete.
+            fclose(file);
+            return false;
+        }
+        records.push_back(record);
+    }
+    const bool complete = feof(file) != 0;
+    fclose(file);
+    return complete;
+}
+
+/**
+ * @brief Writes a scan log, see loadScanLog().
+ *
+ * @param [in] path: The path of the log, which is overwritten.
+ *
+ * @param [in] records: The sweeps to write.
+ *
+ * @return [bool] - True if the file was written successfully.
+ */
+inline bool saveScanLog(const char *path, const std::vector<ScanRecord> &records) {
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    for (const auto &record : records) {
+        fprintf(file, "%.3f %.3f %.3f", record.x, record.y, record.angleDegree);
+        for (auto distance : record.distances) {
+            fprintf(file, " %.2f", distance);
+        }
+        fputc('\n', file);
+    }
+    return fclose(file) == 0;
+}
+} // namespace Mapping
+
+#endif // SCAN_LOG_HPP
@@ -0,0 +1,190 @@
+/**
+ * @file
+ * @brief     Work-stealing thread pool class (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Mapping {
+/**
+ * @brief This class runs tasks on a fixed set of threads.
+ *
+ * Every worker thread has its own task queue. A task submitted from
+ * a worker goes to the queue of that worker, other tasks are spread
+ * over the queues. A worker takes the newest task of its own queue
+ * first; when its queue is empty, it steals the oldest task from the
+ * queue of another worker. This keeps all threads busy, also when the
+ * tasks take very different amounts of time.
+ */
+class WorkStealingThreadPool {
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    std::atomic<int> queued;
+    std::atomic<int> pending;
+    std::atomic<unsigned> nextQueue;
+    bool stopping;
+
+    ///< The index of the worker that runs on the current thread, or -1.
+    static int &currentWorker() {
+        thread_local int index = -1;
+        return index;
+    }
+
+    bool take(int queueIndex, bool newest, std::function<void()> &task) {
+        auto &queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        if (newest) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        --queued;
+        return true;
+    }
+
+    bool findTask(int worker, std::function<void()> &task) {
+        if (take(worker, true, task)) {
+            return true;
+        }
+        const int count = int(queues.size());
+        for (int i = 1; i < count; ++i) {
+            if (take((worker + i) % count, false, task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void finishTask() {
+        if (--pending == 0) {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            allDone.notify_all();
+        }
+    }
+
+    void work(int worker) {
+        currentWorker() = worker;
+        while (true) {
+            std::function<void()> task;
+            if (findTask(worker, task)) {
+                task();
+                finishTask();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * Starts the worker threads.
+     *
+     * @param [in] threadCount: The amount of worker threads. 0 uses
+     * one thread per hardware thread.
+     */
+    explicit WorkStealingThreadPool(int threadCount = 0) : queued(0), pending(0), nextQueue(0), stopping(false) {
+        if (threadCount <= 0) {
+            threadCount = std::thread::hardware_concurrency() > 0 ? int(std::thread::hardware_concurrency()) : 1;
+        }
+        for (int i = 0; i < threadCount; ++i) {
+            queues.emplace_back(new Queue());
+        }
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back(&WorkStealingThreadPool::work, this, i);
+        }
+    }
+
+    WorkStealingThreadPool(const WorkStealingThreadPool &) = delete;
+    WorkStealingThreadPool &operator=(const WorkStealingThreadPool &) = delete;
+
+    /**
+     * @brief dtor
+     *
+     * Finishes all submitted tasks, and stops the worker threads.
+     */
+    ~WorkStealingThreadPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Submits a task.
+     *
+     * Tasks can also submit new tasks.
+     *
+     * @param [in] task: The task to run on one of the worker threads.
+     */
+    void submit(std::function<void()> task) {
+        const int worker = currentWorker();
+        const int queueIndex = worker >= 0 ? worker : int(nextQueue++ % queues.size());
+        ++pending;
+        {
+            std::lock_guard<std::mutex> lock(queues[queueIndex]->mutex);
+            queues[queueIndex]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            ++queued;
+        }
+        workAvailable.notify_one();
+    }
+
+    /**
+     * @brief Waits until all submitted tasks are finished.
+     *
+     * This function should not be called from a task.
+     */
+    void wait() {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        allDone.wait(lock, [this]() { return pending == 0; });
+    }
+
+    /**
+     * @brief Returns the amount of worker threads.
+     */
+    int getThreadCount() const {
+        return int(threads.size());
+    }
+};
+} // namespace Mapping
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,367 @@
+/**
+ * @file
+ * @brief     Map instrumentation: counters and latency histograms
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <array>
+#include <stdint.h>
+
+namespace Mapping {
+/**
+ * @brief The default instrumentation of Map2D: nothing.
+ *
+ * All functions are empty, so the calls in Map2D compile
+ * out to nothing. MapInstrumentation has the same functions.
+ */
+struct NoInstrumentation {
+    void pointInserted() {
+    }
+
+    void pointRejected() {
+    }
+
+    void sensorMoveRefused() {
+    }
+
+    void sweepFinished(int, bool) {
+    }
+
+    uint32_t startTimer() const {
+        return 0;
+    }
+
+    void insertionFinished(uint32_t) {
+    }
+
+    void graphExportFinished(uint32_t) {
+    }
+};
+
+/**
+ * @brief Reads the cycle counter of a Cortex-M3/M4 (DWT_CYCCNT).
+ *
+ * enable() has to be called once before the counter is used.
+ * Only use this on the MCU: the registers do not exist on a host.
+ */
+struct DwtCycleCounter {
+    static void enable() {
+        ///< DEMCR.TRCENA enables the DWT unit, DWT_CTRL.CYCCNTENA starts the counter.
+        *reinterpret_cast<volatile uint32_t *>(0xE000EDFC) |= uint32_t(1) << 24;
+        *reinterpret_cast<volatile uint32_t *>(0xE0001004) = 0;
+        *reinterpret_cast<volatile uint32_t *>(0xE0001000) |= 1;
+    }
+
+    static uint32_t now() {
+        return *reinterpret_cast<volatile uint32_t *>(0xE0001004);
+    }
+};
+
+/**
+ * @brief A histogram of durations, with fixed power-of-two buckets.
+ *
+ * Bucket 0 counts durations below 2 ticks, bucket i counts durations
+ * in [2^i, 2^(i + 1)) ticks, and the last bucket also counts everything
+ * longer.
+ *
+ * @tparam BucketCount: The amount of buckets, at most 32.
+ */
+template <int BucketCount = 16>
+class LatencyHistogram {
+  private:
+    static_assert(BucketCount > 0 && BucketCount <= 32, "Between 1 and 32 buckets are supported");
+
+    std::array<uint32_t, BucketCount> buckets;
+    uint32_t count;
+    uint32_t maximum;
+
+  public:
+    LatencyHistogram() {
+        reset();
+    }
+
+    /**
+     * @brief Adds a duration.
+     *
+     * @param [in] ticks: The duration, in ticks of the cycle counter.
+     */
+    void record(uint32_t ticks) {
+        const int bucket = ticks < 2 ? 0 : 31 - __builtin_clz(ticks);
+        ++buckets[bucket < BucketCount ? bucket : BucketCount - 1];
+        ++count;
+        maximum = ticks > maximum ? ticks : maximum;
+    }
+
+    /**
+     * @brief Returns the amount of durations in a bucket.
+     *
+     * @param [in] bucket: The index of the bucket, 0 <= bucket < BucketCount.
+     */
+    uint32_t getBucket(int bucket) const {
+        return buckets[bucket];
+    }
+
+    /**
+     * @brief Returns the amount of recorded durations.
+     */
+    uint32_t getCount() const {
+        return count;
+    }
+
+    /**
+     * @brief Returns the longest recorded duration.
+     */
+    uint32_t getMaximum() const {
+        return maximum;
+    }
+
+    void reset() {
+        buckets.fill(0);
+        count = 0;
+        maximum = 0;
+    }
+};
+
+namespace InstrumentationDump {
+/**
+ * @brief Writes a text to a sink, character by character.
+ */
+template <class Sink>
+void writeText(Sink &sink, const char *text) {
+    for (; *text != '\0'; ++text) {
+        sink(*text);
+    }
+}
+
+/**
+ * @brief Writes a number in decimal to a sink.
+ */
+template <class Sink>
+void writeNumber(Sink &sink, uint32_t number) {
+    std::array<char, 10> digits;
+    int count = 0;
+    do {
+        digits[count++] = char('0' + number % 10);
+        number /= 10;
+    } while (number != 0);
+    while (count > 0) {
+        sink(digits[--count]);
+    }
+}
+
+/**
+ * @brief Writes " name value" to a sink.
+ */
+template <class Sink>
+void writeField(Sink &sink, const char *name, uint32_t value) {
+    sink(' ');
+    writeText(sink, name);
+    sink('=');
+    writeNumber(sink, value);
+}
+
+/**
+ * @brief Writes a histogram as "name n=.. max=.. | bucket counts" on a line.
+ */
+template <class Sink, int BucketCount>
+void writeHistogram(Sink &sink, const char *name, const LatencyHistogram<BucketCount> &histogram) {
+    writeText(sink, name);
+    writeField(sink, "n", histogram.getCount());
+    writeField(sink, "max", histogram.getMaximum());
+    writeText(sink, " |");
+    for (int i = 0; i < BucketCount; ++i) {
+        sink(' ');
+        writeNumber(sink, histogram.getBucket(i));
+    }
+    sink('\n');
+}
+} // namespace InstrumentationDump
+
+/**
+ * @brief Instrumentation of Map2D: counters and latency histograms.
+ *
+ * Pass this as the Instrumentation parameter of Map2D to enable
+ * it. It counts the inserted measurements, the measurements that were
+ * rejected because they ended outside of the map, the refused sensor
+ * moves and the changed points per sweep, and keeps histograms of
+ * the time addMeasurement() and getGraph() take.
+ *
+ * @tparam CycleCounter: The time source, with a static uint32_t now(),
+ * for example DwtCycleCounter on the MCU or HostCycleCounter on a host.
+ * @tparam BucketCount: The amount of buckets of the histograms.
+ */
+template <class CycleCounter, int BucketCount = 16>
+class MapInstrumentation {
+  private:
+    uint32_t pointsInserted;
+    uint32_t pointsRejected;
+    uint32_t sensorMovesRefused;
+    uint32_t sweeps;
+    uint32_t cellsChanged;
+    uint32_t maxCellsChanged;
+    uint32_t overflowedSweeps;
+    LatencyHistogram<BucketCount> insertion;
+    LatencyHistogram<BucketCount> graphExport;
+
+  public:
+    MapInstrumentation() {
+        reset();
+    }
+
+    void pointInserted() {
+        ++pointsInserted;
+    }
+
+    void pointRejected() {
+        ++pointsRejected;
+    }
+
+    void sensorMoveRefused() {
+        ++sensorMovesRefused;
+    }
+
+    /**
+     * @brief Registers the end of a sweep.
+     *
+     * @param [in] changedCells: The amount of points in the change log.
+     *
+     * @param [in] overflowed: True if the change log overflowed.
+     */
+    void sweepFinished(int changedCells, bool overflowed) {
+        ++sweeps;
+        cellsChanged += uint32_t(changedCells);
+        maxCellsChanged = uint32_t(changedCells) > maxCellsChanged ? uint32_t(changedCells) : maxCellsChanged;
+        overflowedSweeps += overflowed;
+    }
+
+    uint32_t startTimer() const {
+        return CycleCounter::now();
+    }
+
+    void insertionFinished(uint32_t start) {
+        insertion.record(CycleCounter::now() - start);
+    }
+
+    void graphExportFinished(uint32_t start) {
+        graphExport.record(CycleCounter::now() - start);
+    }
+
+    /**
+     * @brief Returns the amount of measurements that were added.
+     */
+    uint32_t getPointsInserted() const {
+        return pointsInserted;
+    }
+
+    /**
+     * @brief Returns the amount of measurements that were rejected, because
+     * they ended outside of the map.
+     */
+    uint32_t getPointsRejected() const {
+        return pointsRejected;
+    }
+
+    /**
+     * @brief Returns the amount of sensor moves that were refused, because
+     * the new position was outside of the map.
+     */
+    uint32_t getSensorMovesRefused() const {
+        return sensorMovesRefused;
+    }
+
+    /**
+     * @brief Returns the amount of finished sweeps.
+     */
+    uint32_t getSweeps() const {
+        return sweeps;
+    }
+
+    /**
+     * @brief Returns the total amount of changed points of all finished sweeps.
+     *
+     * The change log holds at most Map2D::changeLogCapacity points per sweep.
+     */
+    uint32_t getCellsChanged() const {
+        return cellsChanged;
+    }
+
+    /**
+     * @brief Returns the most changed points in a single sweep.
+     */
+    uint32_t getMaxCellsChanged() const {
+        return maxCellsChanged;
+    }
+
+    /**
+     * @brief Returns the amount of sweeps in which the change log overflowed.
+     */
+    uint32_t getOverflowedSweeps() const {
+        return overflowedSweeps;
+    }
+
+    /**
+     * @brief Returns the durations of addMeasurement().
+     */
+    const LatencyHistogram<BucketCount> &getInsertionLatency() const {
+        return insertion;
+    }
+
+    /**
+     * @brief Returns the durations of getGraph().
+     */
+    const LatencyHistogram<BucketCount> &getGraphExportLatency() const {
+        return graphExport;
+    }
+
+    /**
+     * @brief Resets all counters and histograms.
+     */
+    void reset() {
+        pointsInserted = 0;
+        pointsRejected = 0;
+        sensorMovesRefused = 0;
+        sweeps = 0;
+        cellsChanged = 0;
+        maxCellsChanged = 0;
+        overflowedSweeps = 0;
+        insertion.reset();
+        graphExport.reset();
+    }
+
+    /**
+     * @brief Writes all counters as 3 lines of text.
+     *
+     * For example:
+     *
+     *     map ins=720 oob=3 ref=0 swp=2 chg=410 max=260 ovf=1
+     *     scan n=720 max=3100 | 0 0 0 0 0 0 0 0 12 700 8 0 0 0 0 0
+     *     graph n=0 max=0 | 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0
+     *
+     * The histogram lines give the amount of durations per bucket,
+     * see LatencyHistogram.
+     *
+     * @param [in] sink: Called as sink(character) for every character,
+     * for example [](char c) { hwlib::cout << c; }.
+     */
+    template <class Sink>
+    void dump(Sink sink) const {
+        InstrumentationDump::writeText(sink, "map");
+        InstrumentationDump::writeField(sink, "ins", pointsInserted);
+        InstrumentationDump::writeField(sink, "oob", pointsRejected);
+        InstrumentationDump::writeField(sink, "ref", sensorMovesRefused);
+        InstrumentationDump::writeField(sink, "swp", sweeps);
+        InstrumentationDump::writeField(sink, "chg", cellsChanged);
+        InstrumentationDump::writeField(sink, "max", maxCellsChanged);
+        InstrumentationDump::writeField(sink, "ovf", overflowedSweeps);
+        sink('\n');
+        InstrumentationDump::writeHistogram(sink, "scan", insertion);
+        InstrumentationDump::writeHistogram(sink, "graph", graphExport);
+    }
+};
+} // namespace Mapping
+
+#endif // INSTRUMENTATION_HPP
@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @brief     Compile-time map configuration
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef MAP_CONFIG_HPP
+#define MAP_CONFIG_HPP
+
+#include "angle.hpp"
+#include "math/math.hpp"
+
+namespace Mapping {
+/**
+ * @brief The default configuration of Map2D: everything at run time.
+ *
+ * The scale is given to the constructor of the map, and measurements
+ * have no maximum range.
+ */
+struct RuntimeMapConfig {
+    static constexpr bool isStatic = false;
+    static constexpr double maxRange = 0;
+
+    /**
+     * @brief Returns the scale of the map.
+     *
+     * @param [in] runtimeScale: The scale that was given to the map.
+     */
+    static constexpr double getScale(double runtimeScale) {
+        return runtimeScale;
+    }
+};
+
+/**
+ * @brief The sine and cosine of every step of a sweep.
+ *
+ * Entry i holds the sine and cosine of i * Config::angularStep degrees,
+ * computed with math::sin() and math::cos() at compile time, so they
+ * are exactly the values addMeasurement() computes at run time.
+ */
+template <class Config>
+struct SweepTable {
+    float sine[Config::stepsPerSweep];
+    float cosine[Config::stepsPerSweep];
+
+    constexpr SweepTable() : sine(), cosine() {
+        for (int i = 0; i < Config::stepsPerSweep; ++i) {
+            const float radian = Angle(AngleType::DEG, i * Config::angularStep).asRadian();
+            sine[i] = math::sin(radian);
+            cosine[i] = math::cos(radian);
+        }
+    }
+};
+
+/**
+ * @brief A map configuration that is fixed at compile time, like the one
+ * of a robot model.
+ *
+ * Pass this as the Config parameter of Map2D. The scale becomes a
+ * constant in the arithmetic of the map, and Map2D::addSweep() uses a
+ * sweep table that is computed at compile time instead of a sine and
+ * cosine per measurement. The parameters are integers, because floating
+ * point template parameters are not allowed.
+ *
+ * @tparam ScaleMillimeters: The size of a grid point in millimeters.
+ * @tparam StepMillidegrees: The angle between the measurements of a sweep,
+ * in millidegrees. It has to divide a full turn.
+ * @tparam MaxRangeCentimeters: The range of the sensor in centimeters.
+ * Measurements at or beyond it are ignored; 0 means no maximum.
+ */
+template <int ScaleMillimeters, int StepMillidegrees = 1000, int MaxRangeCentimeters = 0>
+struct MapConfig {
+    static_assert(ScaleMillimeters > 0, "The scale has to be positive");
+    static_assert(StepMillidegrees > 0 && 360000 % StepMillidegrees == 0, "The steps have to divide a full turn");
+    static_assert(MaxRangeCentimeters >= 0, "The maximum range can not be negative");
+
+    static constexpr bool isStatic = true;
+    ///< The amount of centimeters a grid point represents.
+    static constexpr double scale = ScaleMillimeters / 10.0;
+    ///< The angle between the measurements of a sweep, in degrees.
+    static constexpr double angularStep = StepMillidegrees / 1000.0;
+    ///< The amount of measurements in a sweep.
+    static constexpr int stepsPerSweep = 360000 / StepMillidegrees;
+    ///< The range of the sensor in centimeters, 0 for no maximum.
+    static constexpr double maxRange = MaxRangeCentimeters;
+
+    /**
+     * @brief Returns the scale of the map: always the configured one.
+     */
+    static constexpr double getScale(double) {
+        return scale;
+    }
+
+    /**
+     * @brief Returns the sweep table of the configuration.
+     *
+     * The table is a constant, so it is stored in flash.
+     */
+    static const SweepTable<MapConfig> &getSweepTable() {
+        static constexpr SweepTable<MapConfig> table;
+        return table;
+    }
+};
+
+template <int ScaleMillimeters, int StepMillidegrees, int MaxRangeCentimeters>
+constexpr bool MapConfig<ScaleMillimeters, StepMillidegrees, MaxRangeCentimeters>::isStatic;
+
+template <int ScaleMillimeters, int StepMillidegrees, int MaxRangeCentimeters>
+constexpr double MapConfig<ScaleMillimeters, StepMillidegrees, MaxRangeCentimeters>::scale;
+
+template <int ScaleMillimeters, int StepMillidegrees, int MaxRangeCentimeters>
+constexpr double MapConfig<ScaleMillimeters, StepMillidegrees, MaxRangeCentimeters>::angularStep;
+
+template <int ScaleMillimeters, int StepMillidegrees, int MaxRangeCentimeters>
+constexpr int MapConfig<ScaleMillimeters, StepMillidegrees, MaxRangeCentimeters>::stepsPerSweep;
+
+template <int ScaleMillimeters, int StepMillidegrees, int MaxRangeCentimeters>
+constexpr double MapConfig<ScaleMillimeters, StepMillidegrees, MaxRangeCentimeters>::maxRange;
+} // namespace Mapping
+
+#endif // MAP_CONFIG_HPP
@@ -0,0 +1,242 @@
+/**
+ * @file
+ * @brief     Double-buffered map publication class
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef MAP_PUBLISHER_HPP
+#define MAP_PUBLISHER_HPP
+
+#include "angle.hpp"
+#include "bitgrid.hpp"
+#include "vector2d.hpp"
+#include <array>
+#include <atomic>
+#include <stdint.h>
+
+namespace Mapping {
+/**
+ * @brief This class publishes consistent copies of a Map2D to readers
+ * that run concurrently with the mapper, like the planner and telemetry.
+ *
+ * The publisher keeps two copies of the points of the map. Readers get
+ * a const view of the front copy, while the writer brings the back copy
+ * up to date and swaps it to the front with a single atomic exchange.
+ * Only the tiles that changed since the back copy was last published
+ * are copied, see Map2D::getTileVersion().
+ *
+ * Neither side ever waits for the other. Taking and releasing a view is
+ * a single atomic increment each (wait-free). The readers of a copy are
+ * counted per epoch (a term as front copy): when a reader still holds
+ * the back copy, publish() does nothing and returns false, and the next
+ * publish() catches up with everything that changed in between.
+ *
+ * Only one thread may write the map and call publish(); any amount of
+ * threads can take views.
+ *
+ * Expired obstacles disappear from the published copies once tick()
+ * removes them from the map.
+ *
+ * @tparam MapType: The type of the map, a Map2D.
+ */
+template <class MapType>
+class MapPublisher {
+  private:
+    using GridType = typename MapType::GridType;
+
+    /**
+     * @brief A published copy of the map.
+     */
+    struct Copy {
+        GridType obstacles;
+        GridType explored;
+        Vector2D sensorPosition = Vector2D(0, 0);
+        Angle sensorRotation;
+        uint32_t epoch = 0;
+        ///< The tiles that changed in this map version or later are not in the copy.
+        uint32_t mapVersion = 0;
+    };
+
+    MapType &map;
+    std::array<Copy, 2> copies;
+    ///< Bit 0: the index of the front copy. The other bits: the readers that took it in this epoch.
+    std::atomic<uint32_t> front;
+    ///< The readers that released a copy.
+    std::array<std::atomic<uint32_t>, 2> released;
+    ///< The readers that took a copy in its last epoch, only used by the writer.
+    std::array<uint32_t, 2> taken;
+    uint32_t epoch;
+
+    void release(int copy) {
+        released[copy].fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies the tiles that changed since a copy was filled.
+     */
+    void update(Copy &copy) {
+        const int tileSize = GridType::tileSize;
+        for (int tile = 0; tile < GridType::tileCount; ++tile) {
+            if (map.getTileVersion(tile) < copy.mapVersion) {
+                continue;
+            }
+            const auto state = map.readTile(tile);
+            const int left = tile % GridType::tilesPerRow * tileSize;
+            const int top = tile / GridType::tilesPerRow * tileSize;
+            const int width = GridType::width - left < tileSize ? GridType::width - left : tileSize;
+            for (int row = 0; row < tileSize && top + row < GridType::height; ++row) {
+                copy.obstacles.writeBits(left, top + row, width, state.obstacles[row], BitOperation::COPY);
+                copy.explored.writeBits(left, top + row, width, state.explored[row], BitOperation::COPY);
+            }
+        }
+    }
+
+  public:
+    /**
+     * @brief A const view of a published copy.
+     *
+     * The copy does not change while the view exists, so release the
+     * view (let it go out of scope) when done: the writer can not reuse
+     * the copy before that.
+     */
+    class View {
+      private:
+        MapPublisher *publisher;
+        const Copy *copy;
+        int index;
+
+        friend class MapPublisher;
+
+        View(MapPublisher &publisher, int index)
+            : publisher(&publisher), copy(&publisher.copies[index]), index(index) {
+        }
+
+      public:
+        View(View &&other) : publisher(other.publisher), copy(other.copy), index(other.index) {
+            other.publisher = nullptr;
+        }
+
+        View(const View &) = delete;
+        View &operator=(const View &) = delete;
+        View &operator=(View &&) = delete;
+
+        ~View() {
+            if (publisher != nullptr) {
+                publisher->release(index);
+            }
+        }
+
+        /**
+         * @brief Returns the obstacles of the copy.
+         */
+        const GridType &getGrid() const {
+            return copy->obstacles;
+        }
+
+        /**
+         * @brief Returns the explored points of the copy.
+         */
+        const GridType &getExplored() const {
+            return copy->explored;
+        }
+
+        /**
+         * @brief Returns if the point is within the map and an obstacle.
+         */
+        bool isObstacle(const Vector2D &point) const {
+            return MapType::pointWithinMap(point) && copy->obstacles.get(point.x, point.y);
+        }
+
+        /**
+         * @brief Returns if the point is within the map and explored.
+         */
+        bool isExplored(const Vector2D &point) const {
+            return MapType::pointWithinMap(point) && copy->explored.get(point.x, point.y);
+        }
+
+        /**
+         * @brief Returns the position of the sensor at the time of publication.
+         */
+        Vector2D getSensorPosition() const {
+            return copy->sensorPosition;
+        }
+
+        /**
+         * @brief Returns the rotation of the sensor at the time of publication.
+         */
+        Angle getSensorRotation() const {
+            return copy->sensorRotation;
+        }
+
+        /**
+         * @brief Returns the number of the publication, 0 before the first one.
+         */
+        uint32_t getEpoch() const {
+            return copy->epoch;
+        }
+    };
+
+    /**
+     * @brief ctor
+     *
+     * Until the first publish(), the views show an empty map.
+     *
+     * @param [in] map: The map to publish. It has to outlive this object.
+     */
+    explicit MapPublisher(MapType &map) : map(map), front(0), epoch(0) {
+        for (int i = 0; i < 2; ++i) {
+            copies[i].obstacles.clear();
+            copies[i].explored.clear();
+            released[i].store(0);
+            taken[i] = 0;
+        }
+    }
+
+    MapPublisher(const MapPublisher &) = delete;
+    MapPublisher &operator=(const MapPublisher &) = delete;
+
+    /**
+     * @brief Publishes the current state of the map.
+     *
+     * Call this from the writer at a sweep boundary, when the map is
+     * consistent. Starts a new version of the map (see
+     * Map2D::beginVersion()), to tell later changes apart.
+     *
+     * @return [bool] - False if a reader still holds the back copy, in
+     * which case nothing is published.
+     */
+    bool publish() {
+        const int back = 1 - int(front.load(std::memory_order_relaxed) & 1);
+        if (released[back].load(std::memory_order_acquire) != taken[back]) {
+            return false;
+        }
+        released[back].store(0, std::memory_order_relaxed);
+        Copy &copy = copies[back];
+        update(copy);
+        copy.sensorPosition = map.getSensorPosition();
+        copy.sensorRotation = map.getSensorRotation();
+        copy.epoch = ++epoch;
+        copy.mapVersion = map.beginVersion();
+        const uint32_t previous = front.exchange(uint32_t(back), std::memory_order_acq_rel);
+        taken[1 - back] = previous >> 1;
+        return true;
+    }
+
+    /**
+     * @brief Returns a view of the newest published copy. Wait-free.
+     */
+    View view() {
+        return View(*this, int(front.fetch_add(2, std::memory_order_acquire) & 1));
+    }
+
+    /**
+     * @brief Returns the amount of publications.
+     */
+    uint32_t getEpoch() const {
+        return epoch;
+    }
+};
+} // namespace Mapping
+
+#endif // MAP_PUBLISHER_HPP
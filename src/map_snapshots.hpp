@@ -0,0 +1,252 @@
+/**
+ * @file
+ * @brief     Copy-on-write map snapshot class
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef MAP_SNAPSHOTS_HPP
+#define MAP_SNAPSHOTS_HPP
+
+#include <array>
+#include <stdint.h>
+
+namespace Mapping {
+/**
+ * @brief This class takes cheap snapshots of a Map2D, to roll changes back.
+ *
+ * Taking a snapshot copies nothing. Instead, the first time a tile of
+ * the map changes after a snapshot, the old state of the tile is saved
+ * (copy-on-write, through the tile write hook of the map). A snapshot
+ * therefore costs memory only for the tiles that changed after it, and
+ * rolling back or comparing snapshots takes time proportional to the
+ * amount of changed tiles.
+ *
+ * The saved tiles of all snapshots share a single fixed pool. When the
+ * pool is full, the snapshots can no longer be restored: rollback()
+ * and diff() fail until clear() is called.
+ *
+ * Only the points and obstacle time stamps are part of a snapshot,
+ * the sensor pose and the time of the map are not.
+ *
+ * @tparam MapType: The type of the map, a Map2D.
+ * @tparam MaxSnapshots: The maximum amount of snapshots at the same time.
+ * @tparam TileCapacity: The maximum amount of saved tiles of all snapshots together.
+ */
+template <class MapType, int MaxSnapshots = 4, int TileCapacity = 64>
+class MapSnapshots {
+  public:
+    ///< Pass to diff() to compare against the current state of the map.
+    static constexpr int current = -1;
+
+  private:
+    using Tile = typename MapType::Tile;
+    static constexpr int tileCount = MapType::GridType::tileCount;
+
+    MapType &map;
+    std::array<Tile, TileCapacity> savedTiles;
+    int savedTileCount;
+    ///< Snapshot i owns the saved tiles [firstSavedTile[i], firstSavedTile[i + 1]).
+    std::array<int, MaxSnapshots> firstSavedTile;
+    int snapshotCount;
+    bool overflowed;
+    ///< The tiles that are saved for the newest snapshot.
+    std::array<uint32_t, (tileCount + 31) / 32> savedForNewest;
+
+    static bool hasTile(const std::array<uint32_t, (tileCount + 31) / 32> &set, int tile) {
+        return (set[tile / 32] >> (tile % 32)) & 1;
+    }
+
+    static void addTile(std::array<uint32_t, (tileCount + 31) / 32> &set, int tile) {
+        set[tile / 32] |= uint32_t(1) << (tile % 32);
+    }
+
+    static void onTileWrite(void *context, int tile) {
+        static_cast<MapSnapshots *>(context)->saveTile(tile);
+    }
+
+    void saveTile(int tile) {
+        if (snapshotCount == 0 || hasTile(savedForNewest, tile)) {
+            return;
+        }
+        if (savedTileCount == TileCapacity) {
+            overflowed = true;
+            return;
+        }
+        savedTiles[savedTileCount++] = map.readTile(tile);
+        addTile(savedForNewest, tile);
+    }
+
+    int savedTilesEnd(int snapshot) const {
+        return snapshot + 1 < snapshotCount ? firstSavedTile[snapshot + 1] : savedTileCount;
+    }
+
+    bool valid(int snapshot) const {
+        return !overflowed && snapshot >= 0 && snapshot < snapshotCount;
+    }
+
+    /**
+     * @brief Returns the state of a tile at the time of a snapshot.
+     *
+     * The oldest tile that was saved at or after the snapshot holds the
+     * state; when there is none, the tile did not change since.
+     */
+    Tile tileAt(int snapshot, int tile) const {
+        const int first = snapshot == current ? savedTileCount : firstSavedTile[snapshot];
+        for (int i = first; i < savedTileCount; ++i) {
+            if (savedTiles[i].index == tile) {
+                return savedTiles[i];
+            }
+        }
+        return map.readTile(tile);
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * Installs the tile write hook of the map. The map has to outlive
+     * this object, and can have only one MapSnapshots at a time.
+     *
+     * @param [in] map: The map to take snapshots of.
+     */
+    explicit MapSnapshots(MapType &map) : map(map), savedTileCount(0), snapshotCount(0), overflowed(false) {
+        savedForNewest.fill(0);
+        map.setTileWriteHook(&MapSnapshots::onTileWrite, this);
+    }
+
+    MapSnapshots(const MapSnapshots &) = delete;
+    MapSnapshots &operator=(const MapSnapshots &) = delete;
+
+    /**
+     * @brief dtor
+     *
+     * Removes the tile write hook of the map.
+     */
+    ~MapSnapshots() {
+        map.setTileWriteHook(nullptr, nullptr);
+    }
+
+    /**
+     * @brief Takes a snapshot of the current state of the map.
+     *
+     * @return [int] - The id of the snapshot, or -1 when there are
+     * already MaxSnapshots snapshots. The ids count up from 0, in the
+     * order the snapshots are taken.
+     */
+    int takeSnapshot() {
+        if (snapshotCount == MaxSnapshots) {
+            return -1;
+        }
+        firstSavedTile[snapshotCount] = savedTileCount;
+        savedForNewest.fill(0);
+        map.beginVersion();
+        return snapshotCount++;
+    }
+
+    /**
+     * @brief Restores the map to the state of a snapshot.
+     *
+     * The saved tiles are written back from the newest to the oldest,
+     * so every tile ends up in its oldest state at or after the
+     * snapshot. The snapshot is kept, the newer ones are dropped.
+     *
+     * @param [in] snapshot: The id of the snapshot.
+     *
+     * @return [bool] - False if the snapshot does not exist, or can
+     * not be restored because the tile pool overflowed.
+     */
+    bool rollback(int snapshot) {
+        if (!valid(snapshot)) {
+            return false;
+        }
+        for (int i = savedTileCount - 1; i >= firstSavedTile[snapshot]; --i) {
+            map.writeTile(savedTiles[i]);
+        }
+        savedTileCount = savedTilesEnd(snapshot);
+        snapshotCount = snapshot + 1;
+        savedForNewest.fill(0);
+        for (int i = firstSavedTile[snapshot]; i < savedTileCount; ++i) {
+            addTile(savedForNewest, savedTiles[i].index);
+        }
+        map.beginVersion();
+        return true;
+    }
+
+    /**
+     * @brief Calls a function for every tile that differs between two states.
+     *
+     * Only the tiles that were saved after the older snapshot are
+     * compared, so this takes time proportional to the changed tiles.
+     * Tiles that changed and changed back are not reported.
+     *
+     * @param [in] from: The id of a snapshot.
+     *
+     * @param [in] to: The id of a newer snapshot, or current.
+     *
+     * @param [in] function: Called as function(tile) with the index of
+     * every tile that differs, in the order the tiles first changed.
+     *
+     * @return [bool] - False if a snapshot does not exist, or can not
+     * be restored because the tile pool overflowed.
+     */
+    template <class F>
+    bool diff(int from, int to, F function) const {
+        if (!valid(from) || (to != current && (!valid(to) || to < from))) {
+            return false;
+        }
+        const int end = to == current ? savedTileCount : firstSavedTile[to];
+        std::array<uint32_t, (tileCount + 31) / 32> visited;
+        visited.fill(0);
+        for (int i = firstSavedTile[from]; i < end; ++i) {
+            const int tile = savedTiles[i].index;
+            if (!hasTile(visited, tile)) {
+                addTile(visited, tile);
+                if (!tileAt(from, tile).samePoints(tileAt(to, tile))) {
+                    function(tile);
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Drops all snapshots, keeping the map as it is.
+     */
+    void clear() {
+        savedTileCount = 0;
+        snapshotCount = 0;
+        overflowed = false;
+        savedForNewest.fill(0);
+    }
+
+    /**
+     * @brief Returns the amount of snapshots.
+     */
+    int getSnapshotCount() const {
+        return snapshotCount;
+    }
+
+    /**
+     * @brief Returns the amount of tiles that are saved for all snapshots together.
+     */
+    int getSavedTileCount() const {
+        return savedTileCount;
+    }
+
+    /**
+     * @brief Returns if the tile pool overflowed, see clear().
+     */
+    bool isOverflowed() const {
+        return overflowed;
+    }
+};
+
+template <class MapType, int MaxSnapshots, int TileCapacity>
+constexpr int MapSnapshots<MapType, MaxSnapshots, TileCapacity>::current;
+
+template <class MapType, int MaxSnapshots, int TileCapacity>
+constexpr int MapSnapshots<MapType, MaxSnapshots, TileCapacity>::tileCount;
+} // namespace Mapping
+
+#endif // MAP_SNAPSHOTS_HPP
@@ -0,0 +1,554 @@
+/**
+ * @file
+ * @brief     Map streaming encoder and decoder classes
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef MAP_STREAM_HPP
+#define MAP_STREAM_HPP
+
+#include "bitgrid.hpp"
+#include <array>
+#include <stdint.h>
+
+namespace Mapping {
+/**
+ * @brief The types of frames in a map stream.
+ */
+enum class FrameType : uint8_t { SNAPSHOT = 1, DELTA = 2 };
+
+/**
+ * @brief The result of feeding a byte to a MapStreamDecoder.
+ */
+enum class StreamStatus { INCOMPLETE, SNAPSHOT, DELTA, CHECKSUM_ERROR, SEQUENCE_GAP, INVALID_FRAME };
+
+namespace MapStream {
+///< The first byte of every frame.
+constexpr uint8_t syncByte = 0xA5;
+///< Sync byte, frame type, sequence number (2 bytes) and payload length (2 bytes).
+constexpr int headerSize = 6;
+///< The CRC at the end of every frame.
+constexpr int checksumSize = 2;
+
+/**
+ * @brief Adds a byte to a CRC-16/CCITT checksum (polynomial 0x1021).
+ *
+ * The bitwise version is used, so no table is needed in flash.
+ */
+inline uint16_t crc16(uint16_t crc, uint8_t byte) {
+    crc ^= uint16_t(byte) << 8;
+    for (int i = 0; i < 8; ++i) {
+        crc = (crc & 0x8000) ? uint16_t((crc << 1) ^ 0x1021) : uint16_t(crc << 1);
+    }
+    return crc;
+}
+
+/**
+ * @brief Returns word i of a grid, as it is sent.
+ *
+ * The words are sent in the row-major layout, whatever the
+ * layout of the grid is.
+ */
+template <class Grid>
+uint32_t gridWord(const Grid &grid, int i) {
+    return grid.getRowWord(i / Grid::wordsPerRow, i % Grid::wordsPerRow);
+}
+
+/**
+ * @brief Returns byte i of the words of a grid, little endian.
+ */
+template <class Grid>
+uint8_t gridByte(const Grid &grid, int i) {
+    return uint8_t(gridWord(grid, i / 4) >> (8 * (i % 4)));
+}
+
+/**
+ * @brief Writes bytes to a sink, and keeps the checksum and length.
+ */
+template <class Sink>
+class ByteWriter {
+  private:
+    Sink &sink;
+
+  public:
+    uint16_t crc;
+    int count;
+
+    explicit ByteWriter(Sink &sink) : sink(sink), crc(0xFFFF), count(0) {
+    }
+
+    void put(uint8_t byte) {
+        crc = crc16(crc, byte);
+        ++count;
+        sink(byte);
+    }
+
+    void putUint16(uint16_t value) {
+        put(uint8_t(value));
+        put(uint8_t(value >> 8));
+    }
+
+    void putUint32(uint32_t value) {
+        putUint16(uint16_t(value));
+        putUint16(uint16_t(value >> 16));
+    }
+
+    ///< Unsigned LEB128: 7 bits per byte, the high bit means more bytes follow.
+    void putVarint(uint32_t value) {
+        while (value >= 0x80) {
+            put(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        put(uint8_t(value));
+    }
+};
+
+/**
+ * @brief Counts the bytes of a payload without writing them, used to measure frames.
+ */
+struct ByteCounter {
+    int count = 0;
+
+    void put(uint8_t) {
+        ++count;
+    }
+
+    void putUint16(uint16_t) {
+        count += 2;
+    }
+
+    void putUint32(uint32_t) {
+        count += 4;
+    }
+
+    void putVarint(uint32_t value) {
+        for (++count; value >= 0x80; value >>= 7) {
+            ++count;
+        }
+    }
+};
+} // namespace MapStream
+
+/**
+ * @brief This class encodes a grid into a compact stream of frames.
+ *
+ * The frames are meant to be sent over a slow serial link. Every frame
+ * looks like this (multi-byte values are little endian):
+ *
+ *     0xA5 | type (1) | sequence (2) | payload length (2) | payload | CRC (2)
+ *
+ * The CRC is a CRC-16/CCITT over everything after the sync byte.
+ *
+ * A snapshot frame (type 1) contains the whole grid: the width and height
+ * (2 bytes each), followed by the bytes of the storage words, run-length
+ * encoded. A control byte c < 128 is followed by c + 1 literal bytes, a
+ * control byte c >= 128 is followed by a single byte that is repeated
+ * c - 126 times. The encoder only repeats bytes that occur 3 times or
+ * more, so no grid takes more than a control byte per 128 bytes extra.
+ *
+ * A delta frame (type 2) only contains the words that changed since the
+ * previous frame: for every changed word, the amount of unchanged words
+ * since the previous changed word (varint), followed by the new word
+ * (4 bytes). A delta frame only applies to the frame with the previous
+ * sequence number.
+ *
+ * writeFrame() sends a delta frame when it is smaller than a snapshot.
+ * The first frame, and the frame after requestSnapshot(), is always a
+ * snapshot.
+ *
+ * Example, sending the map over the serial port:
+ *
+ *     encoder.writeFrame(map.getGrid(), [](uint8_t byte) { hwlib::cout << char(byte); });
+ *
+ * @tparam X: The width of the grid.
+ * @tparam Y: The height of the grid.
+ */
+template <int X, int Y>
+class MapStreamEncoder {
+  public:
+    ///< The amount of grid bytes in a snapshot.
+    static constexpr int gridBytes = BitGrid<X, Y>::wordCount * 4;
+    ///< The largest possible payload: a snapshot without any repeated bytes. A repeat run saves at least
+    ///< a byte, which pays for the control byte of the literal run after it. A delta frame is only sent
+    ///< when it is smaller than the snapshot.
+    static constexpr int maxPayloadSize = 4 + gridBytes + gridBytes / 128 + 1;
+    static_assert(maxPayloadSize <= 0xFFFF, "The payload of a snapshot does not fit in the 16-bit length field");
+
+  private:
+    ///< The shortest run that is sent as a repeat. Shorter runs go in the literal runs.
+    static constexpr int minRepeatLength = 3;
+
+    std::array<uint32_t, BitGrid<X, Y>::wordCount> lastSent;
+    uint16_t sequence;
+    bool snapshotRequested;
+
+    template <class Grid>
+    static int repeatLength(const Grid &grid, int start) {
+        const uint8_t byte = MapStream::gridByte(grid, start);
+        int length = 1;
+        while (start + length < gridBytes && length < 129 && MapStream::gridByte(grid, start + length) == byte) {
+            ++length;
+        }
+        return length;
+    }
+
+    template <class Grid, class Writer>
+    static int writeLiterals(const Grid &grid, int start, Writer &writer) {
+        int end = start;
+        while (end < gridBytes && end - start < 128 && repeatLength(grid, end) < minRepeatLength) {
+            ++end;
+        }
+        writer.put(uint8_t(end - start - 1));
+        for (int i = start; i < end; ++i) {
+            writer.put(MapStream::gridByte(grid, i));
+        }
+        return end;
+    }
+
+    /**
+     * @brief Writes the payload of a snapshot.
+     *
+     * @param [in] limit: The writing stops once more bytes than this are written.
+     */
+    template <class Grid, class Writer>
+    static void writeSnapshotPayload(const Grid &grid, Writer &writer, int limit) {
+        writer.putUint16(X);
+        writer.putUint16(Y);
+        int i = 0;
+        while (i < gridBytes && writer.count <= limit) {
+            const int length = repeatLength(grid, i);
+            if (length >= minRepeatLength) {
+                writer.put(uint8_t(126 + length));
+                writer.put(MapStream::gridByte(grid, i));
+                i += length;
+            } else {
+                i = writeLiterals(grid, i, writer);
+            }
+        }
+    }
+
+    template <class Grid, class Writer>
+    void writeDeltaPayload(const Grid &grid, Writer &writer) const {
+        int previous = -1;
+        for (int i = 0; i < BitGrid<X, Y>::wordCount; ++i) {
+            if (MapStream::gridWord(grid, i) != lastSent[i]) {
+                writer.putVarint(i - previous - 1);
+                writer.putUint32(MapStream::gridWord(grid, i));
+                previous = i;
+            }
+        }
+    }
+
+    template <class Grid, class Writer>
+    void writePayload(const Grid &grid, FrameType type, Writer &writer) const {
+        if (type == FrameType::SNAPSHOT) {
+            writeSnapshotPayload(grid, writer, maxPayloadSize);
+        } else {
+            writeDeltaPayload(grid, writer);
+        }
+    }
+
+    /**
+     * @brief Returns the size of the snapshot payload, or a size above the limit.
+     *
+     * The measuring stops as soon as the limit is passed, so a small
+     * delta does not cost a whole encoding of the grid.
+     */
+    template <class Grid>
+    static int snapshotSize(const Grid &grid, int limit) {
+        MapStream::ByteCounter counter;
+        writeSnapshotPayload(grid, counter, limit);
+        return counter.count;
+    }
+
+    template <class Grid>
+    int deltaSize(const Grid &grid) const {
+        MapStream::ByteCounter counter;
+        writeDeltaPayload(grid, counter);
+        return counter.count;
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * Constructs an encoder. The first frame will be a snapshot.
+     */
+    MapStreamEncoder() : sequence(0), snapshotRequested(true) {
+        lastSent.fill(0);
+    }
+
+    /**
+     * @brief Writes the next frame of the stream.
+     *
+     * @param [in] grid: The grid to send, for example Map2D::getGrid().
+     *
+     * @param [in] sink: Called as sink(byte) for every byte of the frame.
+     *
+     * @return [FrameType] - The type of the frame that was written.
+     */
+    template <class Grid, class Sink>
+    FrameType writeFrame(const Grid &grid, Sink sink) {
+        auto type = FrameType::SNAPSHOT;
+        int size = 0;
+        if (snapshotRequested) {
+            size = snapshotSize(grid, maxPayloadSize);
+        } else {
+            size = deltaSize(grid);
+            const int snapshot = snapshotSize(grid, size);
+            if (snapshot <= size) {
+                size = snapshot;
+            } else {
+                type = FrameType::DELTA;
+            }
+        }
+        sink(MapStream::syncByte);
+        MapStream::ByteWriter<Sink> writer(sink);
+        writer.put(uint8_t(type));
+        writer.putUint16(sequence);
+        writer.putUint16(uint16_t(size));
+        writePayload(grid, type, writer);
+        const uint16_t crc = writer.crc;
+        writer.putUint16(crc);
+        for (int i = 0; i < BitGrid<X, Y>::wordCount; ++i) {
+            lastSent[i] = MapStream::gridWord(grid, i);
+        }
+        ++sequence;
+        snapshotRequested = false;
+        return type;
+    }
+
+    /**
+     * @brief Makes the next frame a snapshot.
+     *
+     * Use this when the receiver lost frames, so it can
+     * continue with the next frame.
+     */
+    void requestSnapshot() {
+        snapshotRequested = true;
+    }
+
+    /**
+     * @brief Returns the sequence number of the next frame.
+     */
+    uint16_t getSequence() const {
+        return sequence;
+    }
+};
+
+/**
+ * @brief This class decodes a stream written by MapStreamEncoder.
+ *
+ * The bytes are fed one by one, as they arrive. Bytes before
+ * the start of a frame are skipped. When a frame is complete and
+ * valid, it is applied to the grid of the decoder.
+ *
+ * @tparam X: The width of the grid.
+ * @tparam Y: The height of the grid.
+ */
+template <int X, int Y>
+class MapStreamDecoder {
+  public:
+    ///< The largest possible payload, see MapStreamEncoder::maxPayloadSize.
+    static constexpr int maxPayloadSize = MapStreamEncoder<X, Y>::maxPayloadSize;
+
+  private:
+    std::array<uint8_t, MapStream::headerSize + maxPayloadSize + MapStream::checksumSize> frame;
+    int received;
+    BitGrid<X, Y> grid;
+    uint16_t expectedSequence;
+    bool synchronized;
+
+    uint16_t readUint16(int offset) const {
+        return uint16_t(frame[offset] | (frame[offset + 1] << 8));
+    }
+
+    uint32_t readUint32(int offset) const {
+        return readUint16(offset) | (uint32_t(readUint16(offset + 2)) << 16);
+    }
+
+    int payloadSize() const {
+        return readUint16(4);
+    }
+
+    void setGridByte(int i, uint8_t byte) {
+        const int shift = 8 * (i % 4);
+        grid.setWord(i / 4, (grid.getWord(i / 4) & ~(uint32_t(0xFF) << shift)) | (uint32_t(byte) << shift));
+    }
+
+    bool checksumValid() const {
+        uint16_t crc = 0xFFFF;
+        const int end = MapStream::headerSize + payloadSize();
+        for (int i = 1; i < end; ++i) {
+            crc = MapStream::crc16(crc, frame[i]);
+        }
+        return crc == readUint16(end);
+    }
+
+    /**
+     * @brief Decodes a single run of a snapshot.
+     *
+     * @param [in,out] position: The position of the control byte in the frame,
+     * moved past the run.
+     *
+     * @param [in] end: The end of the payload.
+     *
+     * @param [in,out] i: The index of the next grid byte, moved past the run.
+     *
+     * @return [bool] - False if the run does not fit in the payload or the grid.
+     */
+    bool decodeRun(int &position, int end, int &i) {
+        const uint8_t control = frame[position++];
+        const bool repeated = control >= 128;
+        const int length = repeated ? control - 126 : control + 1;
+        const int inputLength = repeated ? 1 : length;
+        if (i + length > MapStreamEncoder<X, Y>::gridBytes || position + inputLength > end) {
+            return false;
+        }
+        for (int j = 0; j < length; ++j) {
+            setGridByte(i++, frame[position + (repeated ? 0 : j)]);
+        }
+        position += inputLength;
+        return true;
+    }
+
+    /**
+     * @brief Decodes the run-length encoded bytes of a snapshot.
+     *
+     * @return [bool] - True if the payload contained exactly the bytes of the grid.
+     */
+    bool decodeRuns(int position, int end) {
+        int i = 0;
+        while (position < end) {
+            if (!decodeRun(position, end, i)) {
+                return false;
+            }
+        }
+        return i == MapStreamEncoder<X, Y>::gridBytes;
+    }
+
+    StreamStatus applySnapshot() {
+        const int payload = MapStream::headerSize;
+        if (payloadSize() < 4 || readUint16(payload) != X || readUint16(payload + 2) != Y) {
+            return StreamStatus::INVALID_FRAME;
+        }
+        if (!decodeRuns(payload + 4, payload + payloadSize())) {
+            synchronized = false;
+            return StreamStatus::INVALID_FRAME;
+        }
+        return StreamStatus::SNAPSHOT;
+    }
+
+    StreamStatus applyDelta() {
+        int position = MapStream::headerSize;
+        const int end = position + payloadSize();
+        int index = -1;
+        while (position < end) {
+            uint32_t gap = 0;
+            for (int shift = 0; position < end; shift += 7) {
+                gap |= uint32_t(frame[position] & 0x7F) << shift;
+                if (!(frame[position++] & 0x80)) {
+                    break;
+                }
+            }
+            index += gap + 1;
+            if (index >= BitGrid<X, Y>::wordCount || position + 4 > end) {
+                synchronized = false;
+                return StreamStatus::INVALID_FRAME;
+            }
+            grid.setWord(index, readUint32(position));
+            position += 4;
+        }
+        return StreamStatus::DELTA;
+    }
+
+    StreamStatus applyFrame() {
+        if (!checksumValid()) {
+            return StreamStatus::CHECKSUM_ERROR;
+        }
+        const uint16_t sequence = readUint16(2);
+        const auto type = FrameType(frame[1]);
+        if (type == FrameType::DELTA && (!synchronized || sequence != expectedSequence)) {
+            synchronized = false;
+            return StreamStatus::SEQUENCE_GAP;
+        }
+        if (type != FrameType::SNAPSHOT && type != FrameType::DELTA) {
+            return StreamStatus::INVALID_FRAME;
+        }
+        const auto status = type == FrameType::SNAPSHOT ? applySnapshot() : applyDelta();
+        if (status != StreamStatus::INVALID_FRAME) {
+            synchronized = true;
+            expectedSequence = sequence + 1;
+        }
+        return status;
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * Constructs a decoder with an empty grid. The decoder
+     * waits for a snapshot before it accepts delta frames.
+     */
+    MapStreamDecoder() : received(0), expectedSequence(0), synchronized(false) {
+    }
+
+    /**
+     * @brief Feeds the next byte of the stream to the decoder.
+     *
+     * @param [in] byte: The received byte.
+     *
+     * @return [StreamStatus] - INCOMPLETE while a frame is being received.
+     * SNAPSHOT or DELTA when a frame was applied to the grid. CHECKSUM_ERROR,
+     * INVALID_FRAME or SEQUENCE_GAP when a frame was dropped; after a sequence
+     * gap, delta frames are dropped until the next snapshot.
+     */
+    StreamStatus feed(uint8_t byte) {
+        if (received == 0 && byte != MapStream::syncByte) {
+            return StreamStatus::INCOMPLETE;
+        }
+        frame[received++] = byte;
+        if (received == MapStream::headerSize && payloadSize() > maxPayloadSize) {
+            received = 0;
+            return StreamStatus::INVALID_FRAME;
+        }
+        if (received < MapStream::headerSize || received < MapStream::headerSize + payloadSize() + MapStream::checksumSize) {
+            return StreamStatus::INCOMPLETE;
+        }
+        received = 0;
+        return applyFrame();
+    }
+
+    /**
+     * @brief Returns the received grid.
+     */
+    const BitGrid<X, Y> &getGrid() const {
+        return grid;
+    }
+
+    /**
+     * @brief Returns if the grid is up to date with the stream.
+     *
+     * @return [bool] - False before the first snapshot, and after
+     * frames were lost.
+     */
+    bool isSynchronized() const {
+        return synchronized;
+    }
+};
+
+template <int X, int Y>
+constexpr int MapStreamEncoder<X, Y>::gridBytes;
+
+template <int X, int Y>
+constexpr int MapStreamEncoder<X, Y>::maxPayloadSize;
+
+template <int X, int Y>
+constexpr int MapStreamEncoder<X, Y>::minRepeatLength;
+
+template <int X, int Y>
+constexpr int MapStreamDecoder<X, Y>::maxPayloadSize;
+} // namespace Mapping
+
+#endif // MAP_STREAM_HPP
@@ -1,33 +1,74 @@
 #include "math.hpp"
-
-namespace math {
-int pow(int base, int exp) {
-    int result = 1;
-    while (exp) {
-        if (exp & 1)
-            result *= base;
-        exp >>= 1;
-        base *= base;
-    }
-
-    return result;
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+///< pi / 2 in three parts, the first two with few enough bits to multiply exactly.
+constexpr float halfPi1 = 1.5703125f;
+constexpr float halfPi2 = 4.837512969970703125e-4f;
+constexpr float halfPi3 = 7.54978995489188216e-8f;
+constexpr float twoOverPi = 0.636619772367581343f;
+
+///< Minimax coefficients of sin(y) = y + y^3 * P(y^2) and cos(y) = 1 - y^2 / 2 + y^4 * Q(y^2) on [-pi/4, pi/4].
+constexpr float sin1 = -1.6666654611e-1f;
+constexpr float sin2 = 8.3321608736e-3f;
+constexpr float sin3 = -1.9515295891e-4f;
+constexpr float cos1 = 4.166664568298827e-2f;
+constexpr float cos2 = -1.388731625493765e-3f;
+constexpr float cos3 = 2.443315711809948e-5f;
+
+void sincosScalar(float x, float &sinOut, float &cosOut) {
+    const float t = x * twoOverPi;
+    const int quadrant = int(t + (t >= 0 ? 0.5f : -0.5f));
+    const float r = float(quadrant);
+    const float y = ((x - r * halfPi1) - r * halfPi2) - r * halfPi3;
+    const float z = y * y;
+    const float s = y + y * z * (sin1 + z * (sin2 + z * sin3));
+    const float c = 1.0f - 0.5f * z + z * z * (cos1 + z * (cos2 + z * cos3));
+    const bool swap = quadrant & 1;
+    sinOut = (quadrant & 2) ? -(swap ? c : s) : (swap ? c : s);
+    cosOut = ((quadrant + 1) & 2) ? -(swap ? s : c) : (swap ? s : c);
 }
 
-float pow(float base, int exp) {
-    float p = 1.0;
-    for (int i = 1; i <= exp; i++)
-        p = p * base;
-    return p;
-}
-
-int abs(int v) {
-    return v * ((v > 0) - (v < 0));
-}
-
-float abs(float v) {
-    return v * ((v > 0) - (v < 0));
+#if defined(__SSE2__)
+/**
+ * @brief The same steps as sincosScalar(), for 4 angles.
+ */
+void sincos4(const float *in, float *sinOut, float *cosOut) {
+    const __m128 x = _mm_loadu_ps(in);
+    const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(twoOverPi)));
+    const __m128 r = _mm_cvtepi32_ps(quadrant);
+    __m128 y = _mm_sub_ps(x, _mm_mul_ps(r, _mm_set1_ps(halfPi1)));
+    y = _mm_sub_ps(y, _mm_mul_ps(r, _mm_set1_ps(halfPi2)));
+    y = _mm_sub_ps(y, _mm_mul_ps(r, _mm_set1_ps(halfPi3)));
+    const __m128 z = _mm_mul_ps(y, y);
+
+    __m128 p = _mm_add_ps(_mm_set1_ps(sin2), _mm_mul_ps(z, _mm_set1_ps(sin3)));
+    p = _mm_add_ps(_mm_set1_ps(sin1), _mm_mul_ps(z, p));
+    const __m128 s = _mm_add_ps(y, _mm_mul_ps(_mm_mul_ps(y, z), p));
+    __m128 q = _mm_add_ps(_mm_set1_ps(cos2), _mm_mul_ps(z, _mm_set1_ps(cos3)));
+    q = _mm_add_ps(_mm_set1_ps(cos1), _mm_mul_ps(z, q));
+    const __m128 c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), z)),
+                                _mm_mul_ps(_mm_mul_ps(z, z), q));
+
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+    const __m128 sinValue = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+    const __m128 cosValue = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+    ///< Bit 1 of the quadrant (of quadrant + 1 for cos) becomes the sign bit.
+    const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+    const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+    _mm_storeu_ps(sinOut, _mm_xor_ps(sinValue, sinSign));
+    _mm_storeu_ps(cosOut, _mm_xor_ps(cosValue, cosSign));
 }
+#endif
+} // namespace
 
+namespace math {
 float sqrt(const float x) {
     union {
         int i;
@@ -55,38 +96,16 @@ int getPt(int n1, int n2, float perc) {
     return (n1 + (diff * perc));
 }
 
-float fact(int x) {
-    float f = 1.0;
-    for (int i = 1; i <= x; i++) {
-        f = f * i;
+void sincos(const float *in, float *sinOut, float *cosOut, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= n; i += 4) {
+        sincos4(in + i, sinOut + i, cosOut + i);
     }
-    return f;
-}
-
-float cos(float x) {
-    float sum_positive = 0.0;
-    float sum_negative = 0.0;
-    float output = 0.0;
-    for (int i = 4; i <= 20; i += 4) {
-        sum_positive = sum_positive + (pow(x, i) / fact(i));
-    }
-
-    for (int i = 2; i <= 20; i += 4) {
-        sum_negative = sum_negative + (pow(x, i) / fact(i));
-    }
-
-    output = (1 - (sum_negative) + (sum_positive));
-    return output;
-}
-
-float sin(float x) {
-    float sum = 0.0;
-    for (int i = 0; i < 9; i++) {
-        float top = pow(-1, i) * pow(x, 2 * i + 1);
-        float bottom = fact(2 * i + 1);
-        sum = sum + top / bottom;
+#endif
+    for (; i < n; ++i) {
+        sincosScalar(in[i], sinOut[i], cosOut[i]);
     }
-    return sum;
 }
 
 void intToString(int n, char ch1[]) {
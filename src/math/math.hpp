@@ -8,6 +8,8 @@
  * @license     See LICENSE and http://www.boost.org/LICENSE_1_0.txt
  */
 
+#include <stddef.h>
+
 namespace math {
 /**
  * @brief Exponentation of an integer
@@ -21,7 +23,16 @@ namespace math {
  * @param[in] exp The exponent
  * @return integer The base number raised to the power of the exponent
  */
-int pow(int base, int exp);
+constexpr int pow(int base, int exp) {
+    int result = 1;
+    while (exp) {
+        if (exp & 1)
+            result *= base;
+        exp >>= 1;
+        base *= base;
+    }
+    return result;
+}
 
 /**
  * @brief Exponentation of floating pointer
@@ -32,7 +43,12 @@ int pow(int base, int exp);
  * @param[in] exp The exponent
  * @return float The base number raised to the power of the exponent
  */
-float pow(float base, int exp);
+constexpr float pow(float base, int exp) {
+    float p = 1.0;
+    for (int i = 1; i <= exp; i++)
+        p = p * base;
+    return p;
+}
 
 /**
  * @brief Calculation of absolute value of a integer
@@ -42,7 +58,9 @@ float pow(float base, int exp);
  * @param[in] v The value to be made absolute
  * @return integer The absolute value
  */
-int abs(int v);
+constexpr int abs(int v) {
+    return v * ((v > 0) - (v < 0));
+}
 /**
  * @brief Calculation of absolute value of a floatig pointer
  * @details This function was made by Jens Gustedt
@@ -51,7 +69,9 @@ int abs(int v);
  * @param[in] v The value to be made absolute
  * @return float The absolute value
  */
-float abs(float v);
+constexpr float abs(float v) {
+    return v * ((v > 0) - (v < 0));
+}
 
 /**
  * @brief Two Babylonian Steps (simplfied) square root
@@ -94,7 +114,13 @@ int getPt(int n1, int n2, float perc);
  * @param[in] x
  * @return float
  */
-float fact(int x);
+constexpr float fact(int x) {
+    float f = 1.0;
+    for (int i = 1; i <= x; i++) {
+        f = f * i;
+    }
+    return f;
+}
 
 /**
  * @brief Modified Taylor series cos alghorithm
@@ -103,7 +129,21 @@ float fact(int x);
  * @param[in] x
  * @return float
  */
-float cos(float x);
+constexpr float cos(float x) {
+    float sum_positive = 0.0;
+    float sum_negative = 0.0;
+    float output = 0.0;
+    for (int i = 4; i <= 20; i += 4) {
+        sum_positive = sum_positive + (pow(x, i) / fact(i));
+    }
+
+    for (int i = 2; i <= 20; i += 4) {
+        sum_negative = sum_negative + (pow(x, i) / fact(i));
+    }
+
+    output = (1 - (sum_negative) + (sum_positive));
+    return output;
+}
 
 /**
  * @brief Modified Taylor series sin alghorithm
@@ -113,7 +153,29 @@ float cos(float x);
  * @param[in] x
  * @return float
  */
-float sin(float x);
+constexpr float sin(float x) {
+    float sum = 0.0;
+    for (int i = 0; i < 9; i++) {
+        float top = pow(-1, i) * pow(x, 2 * i + 1);
+        float bottom = fact(2 * i + 1);
+        sum = sum + top / bottom;
+    }
+    return sum;
+}
+
+/**
+ * @brief Batch sin and cos of an array of angles
+ * @details The angles are reduced to [-pi/4, pi/4] with a three-part (Cody-Waite) multiple of pi/2, and both
+ * functions are evaluated there with minimax polynomials in Horner form; the quadrant picks and signs the results.
+ * There are no loops or branches per angle: with SSE2 four angles are done at a time, other targets (ARM) use the
+ * same steps one angle at a time. The absolute error is below 1e-6 for |angle| < 1e4 radians.
+ *
+ * @param[in] in The angles in radians
+ * @param[out] sinOut The sines, may not overlap with the other arrays
+ * @param[out] cosOut The cosines, may not overlap with the other arrays
+ * @param[in] n The amount of angles
+ */
+void sincos(const float *in, float *sinOut, float *cosOut, size_t n);
 
 /**
  * @brief This function will convert a integer to a char array.
@@ -12,8 +12,20 @@ namespace math {
 /**
  * @brief This function rounds a given floating point number
  * to an integer.
+ *
+ * Halfway cases are rounded away from zero, so negative
+ * numbers round the same way as positive ones.
  */
-int round(double number);
+constexpr int round(double number) {
+    if (number < 0) {
+        return -round(-number);
+    }
+    if (number - (int)number < 0.5) {
+        return (int)number;
+    } else {
+        return (int)number + 1;
+    }
+}
 } // namespace math
 
 #endif
\ No newline at end of file
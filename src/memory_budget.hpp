@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @brief     Static memory footprints and the SRAM budget check
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef MEMORY_BUDGET_HPP
+#define MEMORY_BUDGET_HPP
+
+#include <stddef.h>
+
+namespace Mapping {
+namespace MemoryBudget {
+///< The SRAM of the SAM3X8E (Arduino Due): 64 KB + 32 KB.
+constexpr size_t dueSram = 96 * 1024;
+///< The stack of the firmware, see STACK_SIZE in BuildModule.cmake. Maps that live in main() come out of this.
+constexpr size_t dueStack = 92160;
+
+/**
+ * @brief Returns the amount of bytes the components take together.
+ *
+ * None of the components allocate, so their size is their whole
+ * footprint. The sizes are those of the compiler that evaluates this:
+ * use the target compiler for the exact footprint on the target.
+ */
+template <class... Components>
+constexpr size_t footprint() {
+    const size_t sizes[] = {0, sizeof(Components)...};
+    size_t total = 0;
+    for (size_t size : sizes) {
+        total += size;
+    }
+    return total;
+}
+} // namespace MemoryBudget
+
+/**
+ * @brief Fails to compile when the components do not fit in a budget.
+ *
+ * Instantiate it with the components that share a part of the memory,
+ * for example the ones that live on the stack of main():
+ *
+ *     template struct Mapping::SramBudget<Mapping::MemoryBudget::dueStack - 4096, MapType, FrontierDetector<X, Y>>;
+ *
+ * Leave room in the budget for everything that is not declared, like
+ * call frames.
+ *
+ * @tparam Budget: The amount of bytes available.
+ * @tparam Components: The types of the components.
+ */
+template <size_t Budget, class... Components>
+struct SramBudget {
+    ///< The bytes the components take together.
+    static constexpr size_t used = MemoryBudget::footprint<Components...>();
+    static_assert(used <= Budget, "The components do not fit in the SRAM budget");
+    ///< The bytes that are left.
+    static constexpr size_t remaining = Budget - used;
+};
+
+template <size_t Budget, class... Components>
+constexpr size_t SramBudget<Budget, Components...>::used;
+
+template <size_t Budget, class... Components>
+constexpr size_t SramBudget<Budget, Components...>::remaining;
+} // namespace Mapping
+
+#endif // MEMORY_BUDGET_HPP
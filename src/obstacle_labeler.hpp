@@ -0,0 +1,294 @@
+/**
+ * @file
+ * @brief     Obstacle labeler class
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ */
+
+#ifndef OBSTACLE_LABELER_HPP
+#define OBSTACLE_LABELER_HPP
+
+#include "vector2d.hpp"
+#include <array>
+#include <stdint.h>
+
+namespace Mapping {
+/**
+ * @brief A group of connected obstacle points.
+ */
+struct Obstacle {
+    Obstacle() : min(0, 0), max(0, 0), centroid(0, 0), cellCount(0) {
+    }
+    Vector2D min;      ///< The top left corner of the bounding box.
+    Vector2D max;      ///< The bottom right corner of the bounding box (inclusive).
+    Vector2D centroid; ///< The average position of the points, rounded down.
+    int cellCount;     ///< The amount of obstacle points.
+};
+
+/**
+ * @brief This class groups the obstacle points of a grid into objects.
+ *
+ * Obstacle points that touch each other (also diagonally) belong to
+ * the same object. The grid is labeled in a single pass, row by row:
+ * every row is split into runs of consecutive obstacle points, which
+ * are read from the bit-packed words with count-trailing-zeros. A run
+ * gets the label of the runs it touches in the previous row. When a run
+ * touches runs with different labels, those labels are merged
+ * (union-find).
+ *
+ * All the memory is allocated in the object itself, so it can be
+ * placed in static memory. The size of the label table limits the amount
+ * of labels: when it runs out, the remaining obstacle points are left
+ * out of the result and labelsOverflowed() returns true.
+ *
+ * @tparam X: The width of the grid.
+ * @tparam Y: The height of the grid.
+ * @tparam MaxLabels: The size of the label table, and the maximum
+ * amount of objects.
+ */
+template <int X, int Y, int MaxLabels = 64>
+class ObstacleLabeler {
+  private:
+    ///< The maximum amount of runs in a single row.
+    static constexpr int maxRunsPerRow = (X + 1) / 2;
+
+    struct Run {
+        int start;
+        int end;
+        int label;
+    };
+
+    struct LabelStatistics {
+        int cellCount;
+        int64_t sumX;
+        int64_t sumY;
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    std::array<int, MaxLabels> parent;
+    std::array<LabelStatistics, MaxLabels> statistics;
+    int labelCount;
+    bool overflowed;
+
+    std::array<std::array<Run, maxRunsPerRow>, 2> runs;
+    std::array<int, 2> runCount;
+
+    std::array<Obstacle, MaxLabels> obstacles;
+    int obstacleCount;
+
+    int find(int label) {
+        while (parent[label] != label) {
+            parent[label] = parent[parent[label]];
+            label = parent[label];
+        }
+        return label;
+    }
+
+    int newLabel() {
+        if (labelCount == MaxLabels) {
+            overflowed = true;
+            return -1;
+        }
+        parent[labelCount] = labelCount;
+        statistics[labelCount] = {0, 0, 0, X, Y, -1, -1};
+        return labelCount++;
+    }
+
+    /**
+     * @brief Merges two labels, and returns the root of the result.
+     *
+     * A label of -1 (no label) is ignored.
+     */
+    int merge(int a, int b) {
+        if (a < 0 || b < 0) {
+            return a < 0 ? b : a;
+        }
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return a;
+        }
+        if (b < a) {
+            int temporary = a;
+            a = b;
+            b = temporary;
+        }
+        parent[b] = a;
+        auto &target = statistics[a];
+        const auto &source = statistics[b];
+        target.cellCount += source.cellCount;
+        target.sumX += source.sumX;
+        target.sumY += source.sumY;
+        target.minX = source.minX < target.minX ? source.minX : target.minX;
+        target.minY = source.minY < target.minY ? source.minY : target.minY;
+        target.maxX = source.maxX > target.maxX ? source.maxX : target.maxX;
+        target.maxY = source.maxY > target.maxY ? source.maxY : target.maxY;
+        return a;
+    }
+
+    void addRunToLabel(const Run &run, int y) {
+        auto &stats = statistics[run.label];
+        const int length = run.end - run.start + 1;
+        stats.cellCount += length;
+        stats.sumX += (run.start + run.end) * length / 2;
+        stats.sumY += int64_t(y) * length;
+        stats.minX = run.start < stats.minX ? run.start : stats.minX;
+        stats.minY = y < stats.minY ? y : stats.minY;
+        stats.maxX = run.end > stats.maxX ? run.end : stats.maxX;
+        stats.maxY = y > stats.maxY ? y : stats.maxY;
+    }
+
+    /**
+     * @brief Labels a run of the current row.
+     *
+     * The run gets the label of all the runs of the previous row it
+     * touches, or a new label if it touches none.
+     *
+     * @param [in,out] previousIndex: The first run of the previous row that can
+     * still touch this run or the runs after it.
+     */
+    void labelRun(Run &run, int y, const std::array<Run, maxRunsPerRow> &previous, int previousCount, int &previousIndex) {
+        while (previousIndex < previousCount && previous[previousIndex].end < run.start - 1) {
+            ++previousIndex;
+        }
+        run.label = -1;
+        for (int i = previousIndex; i < previousCount && previous[i].start <= run.end + 1; ++i) {
+            run.label = merge(run.label, previous[i].label);
+        }
+        if (run.label < 0) {
+            run.label = newLabel();
+        }
+        if (run.label >= 0) {
+            run.label = find(run.label);
+            addRunToLabel(run, y);
+        }
+    }
+
+    void addRun(int row, int start, int end) {
+        runs[row][runCount[row]++] = {start, end, -1};
+    }
+
+    /**
+     * @brief Splits a row of the grid into runs of obstacle points.
+     *
+     * @param [in] grid: The grid.
+     *
+     * @param [in] y: The row of the grid.
+     *
+     * @param [in] row: The run buffer to store the runs in.
+     */
+    template <class Grid>
+    void extractRuns(const Grid &grid, int y, int row) {
+        runCount[row] = 0;
+        int runStart = -1;
+        for (int wordInRow = 0; wordInRow < Grid::wordsPerRow; ++wordInRow) {
+            const uint32_t word = grid.getRowWord(y, wordInRow);
+            const int base = wordInRow * 32;
+            int bit = 0;
+            while (bit < 32) {
+                ///< Search the next 1 when outside of a run, and the next 0 inside of a run.
+                const uint32_t rest = (runStart < 0 ? word : ~word) >> bit;
+                if (rest == 0) {
+                    break;
+                }
+                bit += __builtin_ctz(rest);
+                if (runStart < 0) {
+                    runStart = base + bit;
+                } else {
+                    addRun(row, runStart, base + bit - 1);
+                    runStart = -1;
+                }
+            }
+        }
+        if (runStart >= 0) {
+            addRun(row, runStart, X - 1);
+        }
+    }
+
+    void labelRow(int y, int row) {
+        const int previousRow = 1 - row;
+        int previousIndex = 0;
+        for (int i = 0; i < runCount[row]; ++i) {
+            labelRun(runs[row][i], y, runs[previousRow], runCount[previousRow], previousIndex);
+        }
+    }
+
+    void collectObstacles() {
+        obstacleCount = 0;
+        for (int label = 0; label < labelCount; ++label) {
+            if (parent[label] != label) {
+                continue;
+            }
+            const auto &stats = statistics[label];
+            auto &obstacle = obstacles[obstacleCount++];
+            obstacle.min = Vector2D(stats.minX, stats.minY);
+            obstacle.max = Vector2D(stats.maxX, stats.maxY);
+            obstacle.centroid = Vector2D(int(stats.sumX / stats.cellCount), int(stats.sumY / stats.cellCount));
+            obstacle.cellCount = stats.cellCount;
+        }
+    }
+
+  public:
+    /**
+     * @brief ctor
+     *
+     * Constructs a labeler with an empty object list.
+     */
+    ObstacleLabeler() : labelCount(0), overflowed(false), runCount{{0, 0}}, obstacleCount(0) {
+    }
+
+    /**
+     * @brief Groups the obstacle points of the grid into objects.
+     *
+     * The result replaces the previous object list.
+     *
+     * @param [in] grid: The grid to label, for example Map2D::getGrid().
+     *
+     * @return [int] - The amount of objects found.
+     */
+    template <class Grid>
+    int label(const Grid &grid) {
+        labelCount = 0;
+        overflowed = false;
+        runCount[1] = 0;
+        for (int y = 0; y < Y; ++y) {
+            const int row = y % 2;
+            extractRuns(grid, y, row);
+            labelRow(y, row);
+        }
+        collectObstacles();
+        return obstacleCount;
+    }
+
+    /**
+     * @brief Returns the amount of objects found by label().
+     */
+    int getObstacleCount() const {
+        return obstacleCount;
+    }
+
+    /**
+     * @brief Returns an object found by label().
+     *
+     * @param [in] index: The index of the object, 0 <= index < getObstacleCount().
+     */
+    const Obstacle &getObstacle(int index) const {
+        return obstacles[index];
+    }
+
+    /**
+     * @brief Returns if the label table was too small.
+     *
+     * @return [bool] - True if obstacle points were left out
+     * of the last result.
+     */
+    bool labelsOverflowed() const {
+        return overflowed;
+    }
+};
+} // namespace Mapping
+
+#endif // OBSTACLE_LABELER_HPP
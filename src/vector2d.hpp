@@ -15,9 +15,10 @@ namespace Mapping {
  * @brief This struct represents a point
  * in 2D space. X and y are the coordinates.
  *
+ * Everything but length() is constexpr.
  */
 struct Vector2D {
-    Vector2D(int x, int y) : x(x), y(y) {
+    constexpr Vector2D(int x, int y) : x(x), y(y) {
     }
     int x;
     int y;
@@ -44,7 +45,7 @@ struct Vector2D {
      *
      * @return [Vector2D] - New sum vector.
      */
-    Vector2D operator+(const Vector2D &other) const {
+    constexpr Vector2D operator+(const Vector2D &other) const {
         return Vector2D(x + other.x, y + other.y);
     }
 
@@ -57,7 +58,7 @@ struct Vector2D {
      * @return [Vector2D] - The vector on which
      * the function has been called - the sum vector.
      */
-    Vector2D &operator+=(const Vector2D &other) {
+    constexpr Vector2D &operator+=(const Vector2D &other) {
         x += other.x;
         y += other.y;
         return *this;
@@ -71,7 +72,7 @@ struct Vector2D {
      *
      * @return [Vector2D] - New difference vector.
      */
-    Vector2D operator-(const Vector2D &other) const {
+    constexpr Vector2D operator-(const Vector2D &other) const {
         return Vector2D(x - other.x, y - other.y);
     }
 
@@ -84,7 +85,7 @@ struct Vector2D {
      * @return [Vector2D] - The vector on which
      * the function has been called - the difference vector.
      */
-    Vector2D &operator-=(const Vector2D &other) {
+    constexpr Vector2D &operator-=(const Vector2D &other) {
         x -= other.x;
         y -= other.y;
         return *this;
@@ -97,7 +98,7 @@ struct Vector2D {
      * @return [Vector2D] - The vector on which
      * the function has been called - multiplied vector.
      */
-    Vector2D operator*(const int &multiplier) const {
+    constexpr Vector2D operator*(const int &multiplier) const {
         return Vector2D(x * multiplier, y * multiplier);
     }
 
@@ -107,13 +108,13 @@ struct Vector2D {
      *
      * @return [Vector2D] - Multiplied vector.
      */
-    Vector2D &operator*=(const int &multiplier) {
+    constexpr Vector2D &operator*=(const int &multiplier) {
         x *= multiplier;
         y *= multiplier;
         return *this;
     }
 
-    bool operator==(const Vector2D &other) const {
+    constexpr bool operator==(const Vector2D &other) const {
         return other.x == x && other.y == y;
     }
 };
@@ -1,8 +1,25 @@
 #define CATCH_CONFIG_MAIN // This tells Catch to provide a main() - only do this in one cpp file
 #include "../src/angle.hpp"
+#include "../src/frontier.hpp"
+#include "../src/hit_deduplicator.hpp"
+#include "../src/host/host_clock.hpp"
+#include "../src/host/map_file.hpp"
+#include "../src/host/parallel_insertion.hpp"
+#include "../src/host/replay.hpp"
 #include "../src/map2d.hpp"
+#include "../src/map_publisher.hpp"
+#include "../src/map_snapshots.hpp"
+#include "../src/map_stream.hpp"
+#include "../src/memory_budget.hpp"
+#include "../src/obstacle_labeler.hpp"
 #include "../src/vector2d.hpp"
 #include "catch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
 
 TEST_CASE("Vector2D", "[Vector2D]") {
     Mapping::Vector2D vec1(3, 4);
@@ -58,6 +75,1175 @@ TEST_CASE("Map2D", "[Map2D]") {
     REQUIRE(map.getSensorPosition() == Mapping::Vector2D(9, 9));            // position remains unchanged
 }
 
+TEST_CASE("Map2D sub-cell sensor position", "[Map2D]") {
+    Mapping::Map2D<10, 10> map(Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+
+    ///< Every move of 1 cm is only a third of a grid point. They
+    ///< should add up instead of being rounded away one by one.
+    for (int i = 0; i < 3; ++i) {
+        map.moveSensorCm(Mapping::Angle(Mapping::AngleType::DEG, 90), 1);
+    }
+    REQUIRE(map.getSensorPosition() == Mapping::Vector2D(6, 5));
+
+    ///< Odometry can also be integrated in sub-cell units directly.
+    map.setSensorPosition(Mapping::Vector2D(5, 5));
+    map.moveSensorSubCells(Mapping::Vector2D(100, -100));
+    REQUIRE(map.getSensorPosition() == Mapping::Vector2D(5, 5));
+    map.moveSensorSubCells(Mapping::Vector2D(100, -100));
+    REQUIRE(map.getSensorPosition() == Mapping::Vector2D(6, 4));
+    REQUIRE(map.getSensorSubCellPosition() == Mapping::Vector2D(5 * 256 + 200, 5 * 256 - 200));
+
+    ///< The measured point is projected from the precise position: 0.78 + 1.33
+    ///< grid points to the right ends up 2 grid points from the start.
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 4);
+    REQUIRE(map.getGrid()[7][4]);
+
+    ///< Moving out of the map is refused, also with sub-cell moves.
+    map.moveSensorSubCells(Mapping::Vector2D(0, -5 * 256));
+    REQUIRE(map.getSensorPosition() == Mapping::Vector2D(6, 4));
+}
+
+TEST_CASE("Map2D explored points", "[Map2D]") {
+    Mapping::Map2D<10, 10> map(Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+    REQUIRE_FALSE(map.isExplored(Mapping::Vector2D(5, 5)));
+
+    ///< A measurement 3 grid points to the right. The points on the
+    ///< ray become explored, the end point becomes an obstacle.
+    map.beginSweep();
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    REQUIRE(map.isExplored(Mapping::Vector2D(5, 5)));
+    REQUIRE(map.isExplored(Mapping::Vector2D(7, 5)));
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(7, 5)));
+    REQUIRE(map.isObstacle(Mapping::Vector2D(8, 5)));
+    REQUIRE(map.isExplored(Mapping::Vector2D(8, 5)));
+    REQUIRE_FALSE(map.isExplored(Mapping::Vector2D(9, 5)));
+
+    ///< All 4 changed points are in the change log.
+    REQUIRE(map.getChangedCellCount() == 4);
+    REQUIRE(map.getChangedCell(3) == Mapping::Vector2D(8, 5));
+    REQUIRE_FALSE(map.changedCellsOverflowed());
+
+    ///< Measuring the same point again changes nothing.
+    map.beginSweep();
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    REQUIRE(map.getChangedCellCount() == 0);
+
+    ///< Clearing the map makes everything unknown again.
+    map.clear();
+    REQUIRE_FALSE(map.isExplored(Mapping::Vector2D(5, 5)));
+    REQUIRE(map.changedCellsOverflowed());
+}
+
+TEST_CASE("Map2D obstacle expiry", "[Map2D]") {
+    Mapping::Map2D<10, 10> map(Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+    map.setObstacleTimeToLive(100);
+    map.tick(0);
+
+    ///< A measured obstacle at (8, 5) and a static one at (2, 2).
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    map.addStaticObstacle(Mapping::Vector2D(2, 2));
+
+    map.tick(50, 0);
+    REQUIRE(map.isObstacle(Mapping::Vector2D(8, 5)));
+
+    ///< Measuring it again keeps it alive.
+    map.tick(80, 0);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    map.tick(150, 0);
+    REQUIRE(map.isObstacle(Mapping::Vector2D(8, 5)));
+
+    ///< After the lifetime the obstacle is ignored right away, but it
+    ///< is only removed from the grid when its row is swept.
+    map.tick(200, 0);
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(8, 5)));
+    REQUIRE(map.getGrid()[8][5]);
+    map.beginSweep();
+    map.tick(200, 10);
+    REQUIRE_FALSE(map.getGrid()[8][5]);
+    REQUIRE(map.getChangedCellCount() == 1);
+    REQUIRE(map.getChangedCell(0) == Mapping::Vector2D(8, 5));
+
+    ///< Static obstacles never expire, and the area stays explored.
+    REQUIRE(map.isObstacle(Mapping::Vector2D(2, 2)));
+    REQUIRE(map.isExplored(Mapping::Vector2D(8, 5)));
+
+    ///< A new measurement in a tile with expired obstacles removes
+    ///< them, instead of bringing them back.
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    map.tick(400, 0);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 12);
+    REQUIRE(map.isObstacle(Mapping::Vector2D(9, 5)));
+    REQUIRE_FALSE(map.getGrid()[8][5]);
+}
+
+TEST_CASE("Map2D region operations", "[Map2D]") {
+    ///< 70 points wide, so the rows take 3 words.
+    Mapping::Map2D<70, 20> map(Mapping::Vector2D(1, 1), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+    map.setObstacleTimeToLive(10);
+    map.tick(0);
+    auto count = [&map](int x0, int y0, int x1, int y1) {
+        int result = 0;
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                result += map.isObstacle(Mapping::Vector2D(x, y));
+            }
+        }
+        return result;
+    };
+
+    ///< A rectangle over a word boundary, clipped to the map.
+    map.beginSweep();
+    map.fillRect(Mapping::Vector2D(20, 2), Mapping::Vector2D(40, 4));
+    map.fillRect(Mapping::Vector2D(60, 18), Mapping::Vector2D(100, 100));
+    REQUIRE(count(0, 0, 69, 19) == 21 * 3 + 10 * 2);
+    REQUIRE(map.isObstacle(Mapping::Vector2D(31, 3)));
+    REQUIRE(map.isObstacle(Mapping::Vector2D(32, 3)));
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(41, 3)));
+    REQUIRE(map.isExplored(Mapping::Vector2D(69, 19)));
+    REQUIRE(map.changedCellsOverflowed());
+
+    ///< Stamped areas are static, so they do not expire.
+    map.tick(100, 20);
+    REQUIRE(count(0, 0, 69, 19) == 21 * 3 + 10 * 2);
+
+    map.clearRect(Mapping::Vector2D(30, 0), Mapping::Vector2D(35, 19));
+    REQUIRE(count(20, 2, 40, 4) == 15 * 3);
+    REQUIRE(map.isExplored(Mapping::Vector2D(33, 3)));
+
+    ///< Copying a region onto an overlapping place.
+    map.clear();
+    map.fillRect(Mapping::Vector2D(10, 10), Mapping::Vector2D(12, 10));
+    map.copyRegion(Mapping::Vector2D(0, 9), Mapping::Vector2D(40, 3), Mapping::Vector2D(25, 8));
+    REQUIRE(count(0, 0, 69, 19) == 6);
+    REQUIRE(count(35, 9, 37, 9) == 3);
+    REQUIRE(map.isObstacle(Mapping::Vector2D(10, 10)));
+
+    ///< Copied obstacles are explored and fresh, expired ones are not copied.
+    map.clear();
+    map.tick(200);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 6);
+    const Mapping::Vector2D measured = map.projectMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 6);
+    map.tick(250);
+    map.copyRegion(measured, Mapping::Vector2D(1, 1), Mapping::Vector2D(50, 15));
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(50, 15)));
+    map.tick(300);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 6);
+    map.tick(305);
+    map.copyRegion(measured, Mapping::Vector2D(1, 1), Mapping::Vector2D(50, 15));
+    REQUIRE(map.isExplored(Mapping::Vector2D(50, 15)));
+    map.tick(312);
+    REQUIRE(map.isObstacle(Mapping::Vector2D(50, 15)));
+    REQUIRE_FALSE(map.isObstacle(measured));
+
+    ///< Copying nothing into a tile does not refresh its other obstacles.
+    map.tick(313);
+    map.copyRegion(Mapping::Vector2D(60, 5), Mapping::Vector2D(1, 1), Mapping::Vector2D(51, 15));
+    map.tick(316);
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(50, 15)));
+
+    ///< A triangle, filled where the centers of the points are inside.
+    map.clear();
+    map.fillPolygon(std::array<Mapping::Vector2D, 3>{
+        {Mapping::Vector2D(0, 0), Mapping::Vector2D(8, 0), Mapping::Vector2D(0, 8)}});
+    REQUIRE(count(0, 0, 69, 19) == 7 + 6 + 5 + 4 + 3 + 2 + 1);
+    REQUIRE(map.isObstacle(Mapping::Vector2D(6, 0)));
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(7, 0)));
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(6, 1)));
+
+    ///< Blitting a mask over a word boundary, and erasing it again.
+    map.clear();
+    Mapping::BitGrid<4, 2> mask;
+    mask.set(0, 0);
+    mask.set(3, 0);
+    mask.set(1, 1);
+    map.blit(mask, Mapping::Vector2D(30, 5));
+    REQUIRE(map.isObstacle(Mapping::Vector2D(30, 5)));
+    REQUIRE(map.isObstacle(Mapping::Vector2D(33, 5)));
+    REQUIRE(map.isObstacle(Mapping::Vector2D(31, 6)));
+    REQUIRE(count(0, 0, 69, 19) == 3);
+    map.blit(mask, Mapping::Vector2D(-3, 0));
+    REQUIRE(map.isObstacle(Mapping::Vector2D(0, 0)));
+    REQUIRE(count(0, 0, 69, 19) == 4);
+    map.blit(mask, Mapping::Vector2D(30, 5), false);
+    REQUIRE(count(0, 0, 69, 19) == 1);
+}
+
+TEST_CASE("Map2D occupied cells", "[Map2D]") {
+    Mapping::Map2D<70, 20> map(Mapping::Vector2D(1, 1), Mapping::Angle(Mapping::AngleType::DEG, 0), 2);
+    REQUIRE(map.occupiedCount() == 0);
+    REQUIRE(map.obstacles().begin() == map.obstacles().end());
+
+    const std::vector<Mapping::Vector2D> points = {Mapping::Vector2D(0, 0), Mapping::Vector2D(31, 0),
+                                                   Mapping::Vector2D(32, 0), Mapping::Vector2D(69, 7),
+                                                   Mapping::Vector2D(5, 19), Mapping::Vector2D(40, 19)};
+    for (const auto &point : points) {
+        map.addStaticObstacle(point);
+    }
+    std::vector<Mapping::Vector2D> visited;
+    for (auto point : map.obstacles()) {
+        visited.push_back(point);
+    }
+    REQUIRE(visited == points);
+    REQUIRE(map.occupiedCount() == 6);
+    REQUIRE(map.getGrid().count() == 6);
+    REQUIRE(map.getGrid().count(31, 0, 69, 7) == 3);
+
+    ///< Restricted to a rectangle, which is clipped to the map.
+    visited.clear();
+    for (auto point : map.obstacles(Mapping::Vector2D(31, -5), Mapping::Vector2D(100, 7))) {
+        visited.push_back(point);
+    }
+    REQUIRE(visited == std::vector<Mapping::Vector2D>(points.begin() + 1, points.begin() + 4));
+    REQUIRE(map.obstacles(Mapping::Vector2D(70, 0), Mapping::Vector2D(80, 5)).begin() ==
+            map.obstacles(Mapping::Vector2D(70, 0), Mapping::Vector2D(80, 5)).end());
+
+    ///< Expired obstacles are skipped, also before they are swept.
+    map.setObstacleTimeToLive(10);
+    map.tick(0);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 20);
+    REQUIRE(map.isObstacle(Mapping::Vector2D(11, 1)));
+    REQUIRE(map.occupiedCount() == 7);
+    map.tick(100, 0);
+    REQUIRE(map.occupiedCount() == 6);
+    int count = 0;
+    for (auto point : map.obstacles()) {
+        count += map.isObstacle(point);
+    }
+    REQUIRE(count == 6);
+
+    ///< Explored statistics.
+    REQUIRE(map.exploredCount() == 6 + 11);
+    REQUIRE(map.getExploredArea() == Approx(17 * 4));
+    REQUIRE(map.getExploredFraction() == Approx(17.0 / (70 * 20)));
+}
+
+TEST_CASE("BitGrid Morton layout", "[Map2D]") {
+    Mapping::BitGrid<70, 20> rowMajor;
+    Mapping::BitGrid<70, 20, Mapping::MortonLayout> morton;
+    REQUIRE(Mapping::BitGrid<70, 20, Mapping::MortonLayout>::wordCount == 9 * 3 * 2);
+
+    ///< The same operations give the same grid, whatever the layout.
+    uint32_t seed = 1;
+    for (int i = 0; i < 200; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const int x = int(seed >> 8) % 70;
+        const int y = int(seed >> 20) % 20;
+        rowMajor.set(x, y);
+        morton.set(x, y);
+    }
+    rowMajor.fillRect(5, 3, 50, 4);
+    morton.fillRect(5, 3, 50, 4);
+    rowMajor.clearRect(30, 0, 40, 19);
+    morton.clearRect(30, 0, 40, 19);
+    rowMajor.copyRegion(rowMajor, 0, 0, 60, 10, 7, 9);
+    morton.copyRegion(morton, 0, 0, 60, 10, 7, 9);
+    rowMajor.writeBits(20, 2, 32, 0xF0F0F0F0, Mapping::BitOperation::COPY);
+    morton.writeBits(20, 2, 32, 0xF0F0F0F0, Mapping::BitOperation::COPY);
+    for (int y = 0; y < 20; ++y) {
+        for (int k = 0; k < 3; ++k) {
+            REQUIRE(morton.getRowWord(y, k) == rowMajor.getRowWord(y, k));
+        }
+        for (int x = 0; x < 70; ++x) {
+            REQUIRE(morton.get(x, y) == rowMajor.get(x, y));
+            REQUIRE(morton.getNeighborhood(x, y) == rowMajor.getNeighborhood(x, y));
+            ///< The gathered neighborhood matches the points one by one, also over word and tile boundaries.
+            uint32_t expected = 0;
+            for (int i = 0; i < Mapping::Neighborhood::size; ++i) {
+                const int nx = x + Mapping::Neighborhood::offsetX[i];
+                const int ny = y + Mapping::Neighborhood::offsetY[i];
+                expected |= uint32_t(nx >= 0 && nx < 70 && ny >= 0 && ny < 20 && rowMajor.get(nx, ny)) << i;
+            }
+            REQUIRE(rowMajor.getNeighborhood(x, y) == expected);
+        }
+    }
+    REQUIRE(morton.count() == rowMajor.count());
+    REQUIRE(morton.readBits(60, 3, 10) == rowMajor.readBits(60, 3, 10));
+
+    ///< Copying between layouts.
+    Mapping::BitGrid<70, 20> copy;
+    copy.copyRegion(morton, 0, 0, 70, 20, 0, 0);
+    for (int y = 0; y < 20; ++y) {
+        for (int k = 0; k < 3; ++k) {
+            REQUIRE(copy.getRowWord(y, k) == rowMajor.getRowWord(y, k));
+        }
+    }
+
+    ///< Neighbors are reported in the order of the offsets.
+    Mapping::BitGrid<16, 16, Mapping::MortonLayout> small;
+    small.set(7, 3);
+    small.set(9, 5);
+    REQUIRE(small.getNeighborhood(8, 4) == ((1u << 0) | (1u << 7)));
+    REQUIRE(small.getNeighborhood(0, 0) == 0);
+}
+
+TEST_CASE("Map2D Morton layout", "[Map2D]") {
+    Mapping::Map2D<70, 40> rowMajor(Mapping::Vector2D(30, 20), Mapping::Angle(Mapping::AngleType::DEG, 0), 2);
+    Mapping::Map2D<70, 40, Mapping::MortonLayout> morton(Mapping::Vector2D(30, 20), Mapping::Angle(Mapping::AngleType::DEG, 0), 2);
+    for (int i = 0; i < 360; i += 3) {
+        const double distance = 20 + (i * 7) % 40;
+        rowMajor.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, i), distance);
+        morton.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, i), distance);
+    }
+    rowMajor.fillRect(Mapping::Vector2D(0, 0), Mapping::Vector2D(69, 1));
+    morton.fillRect(Mapping::Vector2D(0, 0), Mapping::Vector2D(69, 1));
+    for (int y = 0; y < 40; ++y) {
+        for (int x = 0; x < 70; ++x) {
+            REQUIRE(morton.isObstacle(Mapping::Vector2D(x, y)) == rowMajor.isObstacle(Mapping::Vector2D(x, y)));
+            REQUIRE(morton.isExplored(Mapping::Vector2D(x, y)) == rowMajor.isExplored(Mapping::Vector2D(x, y)));
+        }
+    }
+    REQUIRE(morton.occupiedCount() == rowMajor.occupiedCount());
+
+    ///< The stream does not depend on the layout.
+    std::vector<uint8_t> rowMajorBytes;
+    std::vector<uint8_t> mortonBytes;
+    Mapping::MapStreamEncoder<70, 40> rowMajorEncoder;
+    Mapping::MapStreamEncoder<70, 40> mortonEncoder;
+    rowMajorEncoder.writeFrame(rowMajor.getGrid(), [&rowMajorBytes](uint8_t byte) { rowMajorBytes.push_back(byte); });
+    mortonEncoder.writeFrame(morton.getGrid(), [&mortonBytes](uint8_t byte) { mortonBytes.push_back(byte); });
+    REQUIRE(mortonBytes == rowMajorBytes);
+}
+
+TEST_CASE("MapSnapshots", "[Map2D]") {
+    using MapType = Mapping::Map2D<40, 24>;
+    MapType map(Mapping::Vector2D(20, 12), Mapping::Angle(Mapping::AngleType::DEG, 0), 2);
+    map.fillRect(Mapping::Vector2D(0, 0), Mapping::Vector2D(39, 0));
+    Mapping::MapSnapshots<MapType, 3, 8> snapshots(map);
+    auto copyPoints = [&map]() {
+        std::vector<int> points;
+        for (int y = 0; y < 24; ++y) {
+            for (int x = 0; x < 40; ++x) {
+                points.push_back(map.isObstacle(Mapping::Vector2D(x, y)) * 2 + map.isExplored(Mapping::Vector2D(x, y)));
+            }
+        }
+        return points;
+    };
+    auto collectDiff = [&snapshots](int from, int to) {
+        std::vector<int> tiles;
+        REQUIRE(snapshots.diff(from, to, [&tiles](int tile) { tiles.push_back(tile); }));
+        return tiles;
+    };
+
+    const auto original = copyPoints();
+    const int first = snapshots.takeSnapshot();
+    REQUIRE(first == 0);
+    REQUIRE(snapshots.getSavedTileCount() == 0);
+
+    ///< Only the changed tiles are saved.
+    map.addStaticObstacle(Mapping::Vector2D(3, 3));
+    map.addStaticObstacle(Mapping::Vector2D(4, 4));
+    REQUIRE(snapshots.getSavedTileCount() == 1);
+    REQUIRE(collectDiff(first, snapshots.current) == std::vector<int>{0});
+
+    const auto afterFirst = copyPoints();
+    const int second = snapshots.takeSnapshot();
+    map.fillRect(Mapping::Vector2D(30, 20), Mapping::Vector2D(39, 23));
+    map.addStaticObstacle(Mapping::Vector2D(5, 5));
+    REQUIRE(snapshots.getSavedTileCount() == 1 + 3);
+    REQUIRE(collectDiff(second, snapshots.current) == std::vector<int>({13, 14, 0}));
+    REQUIRE(collectDiff(first, second) == std::vector<int>{0});
+
+    ///< A change that is undone is no difference.
+    map.clearRect(Mapping::Vector2D(30, 0), Mapping::Vector2D(39, 0));
+    map.fillRect(Mapping::Vector2D(30, 0), Mapping::Vector2D(39, 0));
+    REQUIRE(snapshots.getSavedTileCount() == 1 + 3 + 2);
+    REQUIRE(collectDiff(second, snapshots.current) == std::vector<int>({13, 14, 0}));
+
+    ///< Rolling back to the newer snapshot keeps it, rolling back further drops it.
+    REQUIRE(snapshots.rollback(second));
+    REQUIRE(copyPoints() == afterFirst);
+    REQUIRE(snapshots.getSnapshotCount() == 2);
+    map.addStaticObstacle(Mapping::Vector2D(39, 23));
+    REQUIRE(snapshots.rollback(second));
+    REQUIRE(copyPoints() == afterFirst);
+    REQUIRE(snapshots.rollback(first));
+    REQUIRE(copyPoints() == original);
+    REQUIRE(snapshots.getSnapshotCount() == 1);
+    REQUIRE_FALSE(snapshots.rollback(second));
+    REQUIRE(map.changedCellsOverflowed());
+
+    ///< Tiles that were restored from a dropped snapshot are saved again.
+    map.fillRect(Mapping::Vector2D(30, 20), Mapping::Vector2D(39, 23));
+    REQUIRE(snapshots.rollback(first));
+    REQUIRE(copyPoints() == original);
+
+    ///< When the pool overflows, the snapshots can not be restored anymore.
+    map.clear();
+    REQUIRE(snapshots.isOverflowed());
+    REQUIRE_FALSE(snapshots.rollback(first));
+    snapshots.clear();
+    REQUIRE(snapshots.takeSnapshot() == 0);
+    map.addStaticObstacle(Mapping::Vector2D(1, 1));
+    REQUIRE(snapshots.rollback(0));
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(1, 1)));
+
+    ///< Expiring tiles without obstacles to remove does not write them.
+    map.setObstacleTimeToLive(10);
+    map.tick(0);
+    const Mapping::Vector2D measured = map.projectMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 0), 4);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 0), 4);
+    snapshots.clear();
+    REQUIRE(snapshots.takeSnapshot() == 0);
+    map.tick(101, 24);
+    REQUIRE(snapshots.getSavedTileCount() == 1);
+    REQUIRE_FALSE(map.getGrid().get(measured.x, measured.y));
+    REQUIRE(snapshots.rollback(0));
+    REQUIRE(map.getGrid().get(measured.x, measured.y));
+
+    ///< A rolled back copy also restores when the tile was seen.
+    map.tick(200);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 0), 4);
+    snapshots.clear();
+    REQUIRE(snapshots.takeSnapshot() == 0);
+    map.tick(205);
+    map.copyRegion(measured, Mapping::Vector2D(1, 1), measured);
+    REQUIRE(snapshots.rollback(0));
+    map.tick(209);
+    REQUIRE(map.isObstacle(measured));
+    map.tick(211);
+    REQUIRE_FALSE(map.isObstacle(measured));
+}
+
+TEST_CASE("MapPublisher", "[Map2D]") {
+    using MapType = Mapping::Map2D<64, 64>;
+    MapType map(Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 1);
+    Mapping::MapPublisher<MapType> publisher(map);
+    REQUIRE(publisher.view().getEpoch() == 0);
+    REQUIRE(publisher.view().getGrid().count() == 0);
+
+    map.addStaticObstacle(Mapping::Vector2D(3, 4));
+    REQUIRE(publisher.publish());
+    map.addStaticObstacle(Mapping::Vector2D(40, 50));
+    {
+        ///< The view keeps showing the published state, also after the next publication.
+        const auto view = publisher.view();
+        REQUIRE(view.getEpoch() == 1);
+        REQUIRE(view.isObstacle(Mapping::Vector2D(3, 4)));
+        REQUIRE_FALSE(view.isObstacle(Mapping::Vector2D(40, 50)));
+        REQUIRE(view.getSensorPosition() == Mapping::Vector2D(5, 5));
+        REQUIRE(publisher.publish());
+        REQUIRE(publisher.view().getGrid().count() == 2);
+        REQUIRE(view.getGrid().count() == 1);
+
+        ///< The back copy is still being read, so nothing is published.
+        map.addStaticObstacle(Mapping::Vector2D(60, 1));
+        REQUIRE_FALSE(publisher.publish());
+        REQUIRE(publisher.view().getEpoch() == 2);
+    }
+    ///< The skipped change is caught up with, although it is in another version.
+    map.addStaticObstacle(Mapping::Vector2D(61, 1));
+    REQUIRE(publisher.publish());
+    REQUIRE(publisher.publish());
+    const auto view = publisher.view();
+    REQUIRE(view.getEpoch() == 4);
+    REQUIRE(view.getGrid().count() == 4);
+    REQUIRE(view.isExplored(Mapping::Vector2D(60, 1)));
+}
+
+TEST_CASE("MapPublisher with concurrent readers", "[Map2D]") {
+    using MapType = Mapping::Map2D<64, 64>;
+    MapType map(Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 1);
+    Mapping::MapPublisher<MapType> publisher(map);
+
+    ///< The writer fills a row point by point per sweep, so a torn copy has a partial row.
+    std::atomic<bool> done(false);
+    std::atomic<int> tornViews(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back([&publisher, &done, &tornViews]() {
+            while (!done.load()) {
+                const auto view = publisher.view();
+                for (int y = 0; y < 64; ++y) {
+                    const int count = view.getGrid().count(0, y, 63, y);
+                    tornViews += count != 0 && count != 64;
+                }
+            }
+        });
+    }
+    int published = 0;
+    for (int y = 0; y < 64; ++y) {
+        for (int x = 0; x < 64; ++x) {
+            map.addStaticObstacle(Mapping::Vector2D(x, y));
+        }
+        published += publisher.publish();
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    REQUIRE(tornViews == 0);
+    REQUIRE(published > 0);
+    REQUIRE(publisher.publish());
+    REQUIRE(publisher.view().getGrid().count() == 64 * 64);
+}
+
+TEST_CASE("Map2D instrumentation", "[Map2D]") {
+    ///< A counter that advances 100 ticks per reading.
+    struct FakeCounter {
+        static uint32_t now() {
+            static uint32_t ticks = 0;
+            return ticks += 100;
+        }
+    };
+    using Instrumentation = Mapping::MapInstrumentation<FakeCounter, 8>;
+    Mapping::Map2D<10, 10, Mapping::RowMajorLayout, Instrumentation> map(
+        Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+
+    map.beginSweep();
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 300);
+    map.setSensorPosition(Mapping::Vector2D(20, 5));
+    map.moveSensorCm(Mapping::Angle(Mapping::AngleType::DEG, 0), 300);
+    map.moveSensorSubCells(Mapping::Vector2D(-10000, 0));
+    REQUIRE_FALSE(map.isObstacle(Mapping::Vector2D(-1, 5)));
+    map.getGraph();
+    map.beginSweep();
+
+    const auto &counters = map.getInstrumentation();
+    REQUIRE(counters.getPointsInserted() == 2);
+    REQUIRE(counters.getSensorMovesRefused() == 3);
+    ///< Only the far measurement is rejected, once. Queries and refused moves are not.
+    REQUIRE(counters.getPointsRejected() == 1);
+    ///< The first beginSweep() does not finish a sweep.
+    REQUIRE(counters.getSweeps() == 1);
+    ///< 3 free points and an obstacle, then the last free point of the row.
+    REQUIRE(counters.getCellsChanged() == 4 + 1);
+    REQUIRE(counters.getMaxCellsChanged() == 5);
+    REQUIRE(counters.getOverflowedSweeps() == 0);
+    REQUIRE(counters.getInsertionLatency().getCount() == 2);
+    REQUIRE(counters.getInsertionLatency().getBucket(6) == 2);
+    REQUIRE(counters.getGraphExportLatency().getMaximum() == 100);
+
+    std::string dump;
+    counters.dump([&dump](char c) { dump += c; });
+    REQUIRE(dump.find("map ins=2 oob=1 ref=3 swp=1") == 0);
+    REQUIRE(dump.find("\nscan n=2 max=100 | 0 0 0 0 0 0 2 0\ngraph n=1") != std::string::npos);
+
+    map.getInstrumentation().reset();
+    REQUIRE(map.getInstrumentation().getPointsInserted() == 0);
+
+    ///< A sweep that overflows the change log still counts all its changes.
+    Mapping::Map2D<64, 64, Mapping::RowMajorLayout, Instrumentation> large(
+        Mapping::Vector2D(32, 32), Mapping::Angle(Mapping::AngleType::DEG, 0), 1);
+    large.beginSweep();
+    for (int i = 0; i < 360; ++i) {
+        large.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, i), 20);
+    }
+    large.beginSweep();
+    REQUIRE(large.getInstrumentation().getOverflowedSweeps() == 1);
+    ///< Every explored point changed once, an obstacle on an explored point once more.
+    REQUIRE(large.getInstrumentation().getCellsChanged() >= uint32_t(large.exploredCount()));
+    REQUIRE(large.getInstrumentation().getCellsChanged() <= uint32_t(large.exploredCount() + large.occupiedCount()));
+    REQUIRE(large.getInstrumentation().getMaxCellsChanged() > uint32_t(large.changeLogCapacity));
+
+    ///< The host clock can be used as well.
+    Mapping::Map2D<10, 10, Mapping::RowMajorLayout, Mapping::MapInstrumentation<Mapping::HostCycleCounter>> timed(
+        Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+    timed.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    REQUIRE(timed.getInstrumentation().getInsertionLatency().getCount() == 1);
+}
+
+TEST_CASE("Map2D compile-time configuration", "[Map2D]") {
+    using Mapping::Angle;
+    using Mapping::AngleType;
+    using Mapping::Vector2D;
+    static_assert(Angle(AngleType::DEG, -8).asDegree() == 352, "Angles are constexpr");
+    static_assert((Angle(AngleType::DEG, 350) + Angle(AngleType::DEG, 20)).asDegree() == 10, "Angles are constexpr");
+    static_assert((Vector2D(1, 2) + Vector2D(3, 4)) * 2 == Vector2D(8, 12), "Vectors are constexpr");
+    static_assert(Mapping::Map2D<10, 10>::pointWithinMap(Vector2D(9, 0)), "Bounds checks are constexpr");
+    static_assert(!Mapping::Map2D<10, 10>::pointWithinMap(Vector2D(10, 0)), "Bounds checks are constexpr");
+    ///< 3 cm straight down from a sensor mounted at (5, 5), at 1 cm per grid point.
+    static_assert(Mapping::Map2D<10, 10>::calculateRelativePosition(Vector2D(5 * 256, 5 * 256), Angle(), 3, 1) ==
+                      Vector2D(5, 8),
+                  "Projections are constexpr");
+
+    using Config = Mapping::MapConfig<10, 1000, 40>;
+    static_assert(Config::stepsPerSweep == 360, "One measurement per degree");
+    constexpr Mapping::SweepTable<Config> table;
+    static_assert(table.sine[0] == 0 && table.cosine[0] == 1, "The table is computed at compile time");
+    REQUIRE(table.sine[90] == math::sin(Angle(AngleType::DEG, 90).asRadian()));
+
+    ///< A sweep gives exactly the same map as the measurements one by one.
+    std::vector<float> distances(Config::stepsPerSweep);
+    for (int i = 0; i < Config::stepsPerSweep; ++i) {
+        distances[i] = float(5 + (i * 7) % 30);
+    }
+    distances[10] = 0;
+    distances[20] = 45;
+    Mapping::Map2D<64, 64, Mapping::RowMajorLayout, Mapping::NoInstrumentation, Config> configured(Vector2D(32, 32),
+                                                                                                   Angle());
+    Mapping::Map2D<64, 64> reference(Vector2D(32, 32), Angle(), 1);
+    configured.addSweep(distances.data());
+    reference.beginSweep();
+    for (int i = 0; i < Config::stepsPerSweep; ++i) {
+        if (i != 10 && i != 20) {
+            reference.addMeasurement(Angle(AngleType::DEG, i * Config::angularStep), distances[i]);
+        }
+    }
+    REQUIRE(configured.getScale() == 1);
+    REQUIRE(configured.occupiedCount() == reference.occupiedCount());
+    REQUIRE(configured.exploredCount() == reference.exploredCount());
+    for (int y = 0; y < 64; ++y) {
+        for (int w = 0; w < 2; ++w) {
+            REQUIRE(configured.getRowWord(y, w) == reference.getRowWord(y, w));
+        }
+    }
+
+    ///< Measurements at the maximum range are ignored.
+    configured.clear();
+    configured.addMeasurement(Angle(), 40);
+    REQUIRE(configured.exploredCount() == 0);
+
+    ///< A rotated sweep lands where the single measurements would.
+    configured.setSensorRotation(Angle(AngleType::DEG, 90));
+    std::fill(distances.begin(), distances.end(), 0.0f);
+    distances[30] = 20;
+    configured.addSweep(distances.data());
+    REQUIRE(configured.occupiedCount() == 1);
+    REQUIRE(configured.isObstacle(configured.projectMeasurement(Angle(AngleType::DEG, 30), 20)));
+}
+
+TEST_CASE("Memory budget", "[Map2D]") {
+    using MapType = Mapping::Map2D<64, 64>;
+    static_assert(MapType::gridFootprint() == 3 * 512, "The grids are bit-packed");
+    static_assert(MapType::gridFootprint() + MapType::changeLogFootprint() + MapType::tileFootprint() < sizeof(MapType),
+                  "The components are part of the map");
+    static_assert(Mapping::MemoryBudget::footprint<MapType, Mapping::FrontierDetector<64, 64>>() ==
+                      sizeof(MapType) + sizeof(Mapping::FrontierDetector<64, 64>),
+                  "The footprints add up");
+    static_assert(Mapping::MemoryBudget::footprint<>() == 0, "Nothing takes nothing");
+
+    ///< A 128 x 128 map with its frontier detector fits on the stack of the Due.
+    using Budget = Mapping::SramBudget<Mapping::MemoryBudget::dueStack, Mapping::Map2D<128, 128>,
+                                       Mapping::FrontierDetector<128, 128>>;
+    REQUIRE(Budget::used == sizeof(Mapping::Map2D<128, 128>) + sizeof(Mapping::FrontierDetector<128, 128>));
+    REQUIRE(Budget::remaining == Mapping::MemoryBudget::dueStack - Budget::used);
+}
+
+TEST_CASE("HitDeduplicator", "[Map2D]") {
+    using Mapping::Angle;
+    using Mapping::AngleType;
+    using Mapping::Vector2D;
+    using MapType = Mapping::Map2D<64, 64>;
+    MapType direct(Vector2D(32, 32), Angle(), 1);
+    MapType deduplicated(Vector2D(32, 32), Angle(), 1);
+    MapType small(Vector2D(32, 32), Angle(), 1);
+    Mapping::HitDeduplicator<MapType> deduplicator(deduplicated);
+    Mapping::HitDeduplicator<MapType, 16> smallDeduplicator(small);
+
+    ///< Two dense sweeps from different positions: many returns end on the same points.
+    for (int sweep = 0; sweep < 2; ++sweep) {
+        const Vector2D position(32 + sweep * 5, 32 - sweep * 3);
+        direct.setSensorPosition(position);
+        deduplicated.setSensorPosition(position);
+        small.setSensorPosition(position);
+        direct.beginSweep();
+        deduplicator.beginSweep();
+        smallDeduplicator.beginSweep();
+        for (int i = 0; i < 1440; ++i) {
+            const Angle angle(AngleType::DEG, i * 0.25);
+            const double distance = 12 + (i / 90) % 3 * 4;
+            direct.addMeasurement(angle, distance);
+            deduplicator.addMeasurement(angle, distance);
+            smallDeduplicator.addMeasurement(angle, distance);
+        }
+        REQUIRE(deduplicator.getStagedCount() > 0);
+        deduplicator.flush();
+        smallDeduplicator.flush();
+        REQUIRE(deduplicator.getStagedCount() == 0);
+
+        for (const MapType *map : {&deduplicated, &small}) {
+            REQUIRE(map->exploredCount() == direct.exploredCount());
+            REQUIRE(map->occupiedCount() == direct.occupiedCount());
+            for (int y = 0; y < 64; ++y) {
+                for (int w = 0; w < 2; ++w) {
+                    REQUIRE(map->getRowWord(y, w) == direct.getRowWord(y, w));
+                }
+            }
+            REQUIRE(map->getChangedCellCount() == direct.getChangedCellCount());
+            for (int i = 0; i < direct.getChangedCellCount(); ++i) {
+                REQUIRE(map->getChangedCell(i) == direct.getChangedCell(i));
+            }
+        }
+    }
+    REQUIRE(deduplicator.getSampleCount() == 2880);
+    REQUIRE(deduplicator.getDistinctCount() < deduplicator.getSampleCount() / 4);
+    REQUIRE(deduplicator.getDeduplicationRatio() > 4);
+    REQUIRE(smallDeduplicator.getDistinctCount() >= deduplicator.getDistinctCount());
+
+    ///< Moving the sensor to another grid point flushes the points of the old one.
+    deduplicator.addMeasurement(Angle(), 10);
+    deduplicated.setSensorPosition(Vector2D(20, 20));
+    deduplicator.addMeasurement(Angle(), 10);
+    REQUIRE(deduplicator.getStagedCount() == 1);
+    REQUIRE(deduplicated.isObstacle(Vector2D(37, 39)));
+
+    ///< The hits of every point are reported on flush.
+    deduplicator.addMeasurement(Angle(), 10);
+    deduplicator.addMeasurement(Angle(AngleType::DEG, 90), 10);
+    int totalHits = 0;
+    int points = 0;
+    deduplicator.flush([&totalHits, &points](const Vector2D &, int hits) {
+        totalHits += hits;
+        ++points;
+    });
+    REQUIRE(points == 2);
+    REQUIRE(totalHits == 3);
+
+    std::string text;
+    deduplicator.resetCounters();
+    deduplicator.addMeasurement(Angle(), 10);
+    deduplicator.addMeasurement(Angle(), 10);
+    deduplicator.flush();
+    deduplicator.dump([&text](char c) { text += c; });
+    REQUIRE(text == "dedup smp=2 pts=1 fl=1\n");
+
+    ///< A point far outside of the map is not folded back into it.
+    MapType farDirect(Vector2D(5, 5), Angle(), 1);
+    MapType farDeduplicated(Vector2D(5, 5), Angle(), 1);
+    Mapping::HitDeduplicator<MapType> farDeduplicator(farDeduplicated);
+    farDirect.addMeasurement(Angle(), 65546);
+    farDeduplicator.addMeasurement(Angle(), 65546);
+    farDeduplicator.addMeasurement(Angle(), 10);
+    farDeduplicator.flush();
+    farDirect.addMeasurement(Angle(), 10);
+    REQUIRE(farDeduplicator.getDistinctCount() == 2);
+    REQUIRE(farDeduplicated.occupiedCount() == 1);
+    REQUIRE(farDeduplicated.isObstacle(Vector2D(5, 15)));
+    REQUIRE(farDeduplicated.exploredCount() == farDirect.exploredCount());
+    for (int y = 0; y < 64; ++y) {
+        for (int w = 0; w < 2; ++w) {
+            REQUIRE(farDeduplicated.getRowWord(y, w) == farDirect.getRowWord(y, w));
+        }
+    }
+}
+
+TEST_CASE("FrontierDetector", "[frontier]") {
+    Mapping::Map2D<10, 10> map(Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+    Mapping::FrontierDetector<10, 10> detector;
+    detector.update(map);
+    REQUIRE(detector.getFrontierCellCount() == 0);
+
+    ///< The ray to the right is explored, everything around it is unknown.
+    map.beginSweep();
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    detector.update(map);
+    REQUIRE(detector.getFrontierCellCount() == 3);
+    REQUIRE(detector.isFrontier(Mapping::Vector2D(6, 5)));
+    REQUIRE_FALSE(detector.isFrontier(Mapping::Vector2D(8, 5))); // obstacle
+
+    ///< The ray to the left extends the same frontier.
+    map.beginSweep();
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, -90), 9);
+    detector.update(map);
+    REQUIRE(detector.getFrontierCellCount() == 5);
+    REQUIRE(detector.extractTargets() == 1);
+    REQUIRE(detector.getTarget(0).cellCount == 5);
+    REQUIRE(detector.getTarget(0).centroid == Mapping::Vector2D(5, 5));
+
+    ///< A measurement from another position creates a separate target,
+    ///< which is ignored when it is too small.
+    map.setSensorPosition(Mapping::Vector2D(1, 1));
+    map.beginSweep();
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+    detector.update(map);
+    REQUIRE(detector.extractTargets() == 2);
+    REQUIRE(detector.extractTargets(2) == 1);
+
+    ///< Maintaining the frontier incrementally gives the same result as a full rescan.
+    for (int angle = 0; angle < 360; angle += 30) {
+        map.beginSweep();
+        map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, angle), 12);
+        detector.update(map);
+    }
+    Mapping::FrontierDetector<10, 10> rebuilt;
+    rebuilt.rebuild(map);
+    REQUIRE(detector.getFrontierCellCount() == rebuilt.getFrontierCellCount());
+    for (int x = 0; x < 10; ++x) {
+        for (int y = 0; y < 10; ++y) {
+            REQUIRE(detector.isFrontier(Mapping::Vector2D(x, y)) == rebuilt.isFrontier(Mapping::Vector2D(x, y)));
+        }
+    }
+}
+
+TEST_CASE("ObstacleLabeler", "[labeler]") {
+    Mapping::BitGrid<40, 10> grid;
+
+    ///< A U shape: the two legs get their own label first,
+    ///< and are merged in the bottom row.
+    grid.set(1, 1);
+    grid.set(3, 1);
+    grid.set(1, 2);
+    grid.set(3, 2);
+    for (int x = 1; x <= 3; ++x) {
+        grid.set(x, 3);
+    }
+    ///< This point only touches the U diagonally.
+    grid.set(4, 4);
+
+    ///< A separate object, which crosses a storage word boundary.
+    for (int x = 28; x <= 35; ++x) {
+        grid.set(x, 7);
+    }
+
+    Mapping::ObstacleLabeler<40, 10> labeler;
+    REQUIRE(labeler.label(grid) == 2);
+    REQUIRE_FALSE(labeler.labelsOverflowed());
+
+    auto u = labeler.getObstacle(0);
+    REQUIRE(u.cellCount == 8);
+    REQUIRE(u.min == Mapping::Vector2D(1, 1));
+    REQUIRE(u.max == Mapping::Vector2D(4, 4));
+    REQUIRE(u.centroid == Mapping::Vector2D(18 / 8, 19 / 8));
+
+    auto bar = labeler.getObstacle(1);
+    REQUIRE(bar.cellCount == 8);
+    REQUIRE(bar.min == Mapping::Vector2D(28, 7));
+    REQUIRE(bar.max == Mapping::Vector2D(35, 7));
+    REQUIRE(bar.centroid == Mapping::Vector2D(31, 7));
+
+    ///< With a label table that is too small, objects are left out.
+    Mapping::ObstacleLabeler<40, 10, 1> smallLabeler;
+    REQUIRE(smallLabeler.label(grid) == 1);
+    REQUIRE(smallLabeler.labelsOverflowed());
+
+    ///< The labeler works on the grid of a map as well.
+    Mapping::Map2D<10, 10> map(Mapping::Vector2D(5, 5), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 9);
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, -90), 9);
+    Mapping::ObstacleLabeler<10, 10> mapLabeler;
+    REQUIRE(mapLabeler.label(map.getGrid()) == 2);
+    REQUIRE(mapLabeler.getObstacle(0).centroid == Mapping::Vector2D(2, 5));
+}
+
+TEST_CASE("MapStream", "[stream]") {
+    Mapping::Map2D<100, 100> map(Mapping::Vector2D(50, 50), Mapping::Angle(Mapping::AngleType::DEG, 0), 3);
+    Mapping::MapStreamEncoder<100, 100> encoder;
+    Mapping::MapStreamDecoder<100, 100> decoder;
+    REQUIRE(decoder.maxPayloadSize == encoder.maxPayloadSize);
+    std::vector<uint8_t> bytes;
+    auto sink = [&bytes](uint8_t byte) { bytes.push_back(byte); };
+    auto feedAll = [&decoder, &bytes]() {
+        auto status = Mapping::StreamStatus::INCOMPLETE;
+        for (auto byte : bytes) {
+            status = decoder.feed(byte);
+        }
+        bytes.clear();
+        return status;
+    };
+
+    ///< The first frame is a snapshot. An empty map of 100x100 takes
+    ///< 1600 bytes, but only a few bytes when run-length encoded.
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 90), 30);
+    REQUIRE(encoder.writeFrame(map.getGrid(), sink) == Mapping::FrameType::SNAPSHOT);
+    REQUIRE(bytes.size() < 50);
+    REQUIRE(feedAll() == Mapping::StreamStatus::SNAPSHOT);
+    REQUIRE(decoder.getGrid()[60][50]);
+
+    ///< A small change is sent as delta frame, with only the changed word.
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 0), 30);
+    REQUIRE(encoder.writeFrame(map.getGrid(), sink) == Mapping::FrameType::DELTA);
+    REQUIRE(bytes.size() == Mapping::MapStream::headerSize + 2 + 4 + Mapping::MapStream::checksumSize);
+    REQUIRE(feedAll() == Mapping::StreamStatus::DELTA);
+    REQUIRE(decoder.getGrid()[50][60]);
+
+    ///< Bytes before a frame are skipped, and a corrupted frame is dropped.
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 180), 30);
+    encoder.writeFrame(map.getGrid(), sink);
+    bytes.insert(bytes.begin(), 0x42);
+    bytes[8] ^= 0x01;
+    REQUIRE(feedAll() == Mapping::StreamStatus::CHECKSUM_ERROR);
+    REQUIRE_FALSE(decoder.getGrid()[50][40]);
+
+    ///< The next delta does not follow the last received frame.
+    encoder.writeFrame(map.getGrid(), sink);
+    REQUIRE(feedAll() == Mapping::StreamStatus::SEQUENCE_GAP);
+    REQUIRE_FALSE(decoder.isSynchronized());
+
+    ///< A snapshot brings the decoder back in sync.
+    encoder.requestSnapshot();
+    REQUIRE(encoder.writeFrame(map.getGrid(), sink) == Mapping::FrameType::SNAPSHOT);
+    REQUIRE(feedAll() == Mapping::StreamStatus::SNAPSHOT);
+    REQUIRE(decoder.isSynchronized());
+    for (int i = 0; i < Mapping::BitGrid<100, 100>::wordCount; ++i) {
+        REQUIRE(decoder.getGrid().getWord(i) == map.getGrid().getWord(i));
+    }
+
+    ///< A grid without any repeated bytes still fits in a snapshot.
+    Mapping::BitGrid<100, 100> noise;
+    for (int i = 0; i < Mapping::BitGrid<100, 100>::wordCount; ++i) {
+        noise.setWord(i, (0x01020304u * uint32_t(i + 1)) & (i % 4 == 3 ? 0xFu : 0xFFFFFFFFu));
+    }
+    encoder.requestSnapshot();
+    encoder.writeFrame(noise, sink);
+    REQUIRE(feedAll() == Mapping::StreamStatus::SNAPSHOT);
+    for (int i = 0; i < Mapping::BitGrid<100, 100>::wordCount; ++i) {
+        REQUIRE(decoder.getGrid().getWord(i) == noise.getWord(i));
+    }
+
+    ///< Bytes that repeat twice ("AABC") are the worst case for the run-length encoding.
+    using Encoder = Mapping::MapStreamEncoder<128, 128>;
+    Mapping::BitGrid<128, 128> pairs;
+    for (int i = 0; i < Mapping::BitGrid<128, 128>::wordCount; ++i) {
+        pairs.setWord(i, 0x43424141);
+    }
+    Encoder pairEncoder;
+    Mapping::MapStreamDecoder<128, 128> pairDecoder;
+    pairEncoder.writeFrame(pairs, sink);
+    REQUIRE(bytes.size() <= size_t(Mapping::MapStream::headerSize + Encoder::maxPayloadSize + Mapping::MapStream::checksumSize));
+    auto status = Mapping::StreamStatus::INCOMPLETE;
+    for (auto byte : bytes) {
+        status = pairDecoder.feed(byte);
+    }
+    bytes.clear();
+    REQUIRE(status == Mapping::StreamStatus::SNAPSHOT);
+    for (int i = 0; i < Mapping::BitGrid<128, 128>::wordCount; ++i) {
+        REQUIRE(pairDecoder.getGrid().getWord(i) == pairs.getWord(i));
+    }
+}
+
+TEST_CASE("MappedMapView", "[file]") {
+    const char *path = "test_map.r2mp";
+    Mapping::Map2D<70, 20> map(Mapping::Vector2D(35, 10), Mapping::Angle(Mapping::AngleType::DEG, 30), 3);
+    map.moveSensorSubCells(Mapping::Vector2D(100, 0));
+    map.addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 60), 90);
+    map.addStaticObstacle(Mapping::Vector2D(0, 0));
+    map.addStaticObstacle(Mapping::Vector2D(69, 19));
+    REQUIRE(Mapping::writeMapFile(path, map));
+
+    ///< The view answers the same queries as the map.
+    Mapping::MappedMapView view;
+    REQUIRE(view.open(path));
+    REQUIRE(view.getWidth() == 70);
+    REQUIRE(view.getHeight() == 20);
+    REQUIRE(view.getScale() == 3);
+    REQUIRE(view.getSensorSubCellPosition() == map.getSensorSubCellPosition());
+    REQUIRE(view.getSensorPosition() == map.getSensorPosition());
+    REQUIRE(view.getSensorRotation().asDegree() == Approx(30));
+    REQUIRE(view.getHeader().rowStride % 8 == 0);
+    for (int x = -1; x <= 70; ++x) {
+        for (int y = -1; y <= 20; ++y) {
+            REQUIRE(view.isObstacle(Mapping::Vector2D(x, y)) == map.isObstacle(Mapping::Vector2D(x, y)));
+        }
+    }
+    view.close();
+    REQUIRE_FALSE(view.isOpen());
+
+    ///< A log-odds payload.
+    REQUIRE(Mapping::writeLogOddsMapFile(path, map, [](int x, int y) { return int8_t(x - y); }));
+    REQUIRE(view.open(path));
+    REQUIRE(view.getLogOdds(Mapping::Vector2D(5, 7)) == -2);
+    REQUIRE(view.isObstacle(Mapping::Vector2D(8, 7)));
+    REQUIRE_FALSE(view.isObstacle(Mapping::Vector2D(7, 7)));
+
+    ///< Headers with a corrupt sensor position or payload offset are refused.
+    auto corruptHeader = [path, &map](void (*corrupt)(Mapping::MapFileHeader &)) {
+        REQUIRE(Mapping::writeMapFile(path, map));
+        FILE *file = fopen(path, "r+b");
+        Mapping::MapFileHeader header;
+        REQUIRE(fread(&header, sizeof(header), 1, file) == 1);
+        corrupt(header);
+        fseek(file, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, file);
+        fclose(file);
+    };
+    corruptHeader([](Mapping::MapFileHeader &header) { header.subCellBits = 40; });
+    REQUIRE_FALSE(view.open(path));
+    corruptHeader([](Mapping::MapFileHeader &header) { header.payloadOffset = 8; });
+    REQUIRE_FALSE(view.open(path));
+    corruptHeader([](Mapping::MapFileHeader &) {});
+    REQUIRE(view.open(path));
+    view.close();
+
+    ///< Any sensor position of a file can be rounded to a grid point.
+    corruptHeader([](Mapping::MapFileHeader &header) { header.sensorX = INT32_MAX; });
+    REQUIRE(view.open(path));
+    REQUIRE(view.getSensorPosition().x == 1 << (31 - view.getHeader().subCellBits));
+    view.close();
+
+    ///< Expired obstacles that are not yet removed are not written.
+    const Mapping::Vector2D measured = map.projectMeasurement(Mapping::Angle(Mapping::AngleType::DEG, 60), 90);
+    map.setObstacleTimeToLive(10);
+    map.tick(50, 0);
+    REQUIRE(map.getGrid().get(measured.x, measured.y));
+    REQUIRE(Mapping::writeMapFile(path, map));
+    REQUIRE(view.open(path));
+    REQUIRE_FALSE(view.isObstacle(measured));
+    REQUIRE(view.isObstacle(Mapping::Vector2D(69, 19)));
+    view.close();
+
+    ///< Files that are not map files are refused.
+    FILE *file = fopen(path, "wb");
+    fputs("not a map", file);
+    fclose(file);
+    REQUIRE_FALSE(view.open(path));
+    REQUIRE_FALSE(view.open("does_not_exist.r2mp"));
+    std::remove(path);
+}
+
+TEST_CASE("WorkStealingThreadPool", "[replay]") {
+    std::atomic<int> counter(0);
+    {
+        Mapping::WorkStealingThreadPool pool(3);
+        REQUIRE(pool.getThreadCount() == 3);
+        ///< Tasks can submit more tasks, wait() returns when all are done.
+        for (int i = 0; i < 100; ++i) {
+            pool.submit([&pool, &counter]() {
+                for (int j = 0; j < 10; ++j) {
+                    pool.submit([&counter]() { ++counter; });
+                }
+            });
+        }
+        pool.wait();
+        REQUIRE(counter == 1000);
+        pool.submit([&counter]() { ++counter; });
+    }
+    ///< The destructor finishes the remaining tasks.
+    REQUIRE(counter == 1001);
+}
+
+namespace {
+///< Creates a sweep in a square room with walls at -200 and 200 cm.
+Mapping::ScanRecord createRoomSweep(double x, double y, double angleDegree) {
+    Mapping::ScanRecord record;
+    record.x = x;
+    record.y = y;
+    record.angleDegree = angleDegree;
+    for (int i = 0; i < Mapping::ScanRecord::samplesPerSweep; ++i) {
+        const double radian = (angleDegree + i) * Mapping::Angle::pi / 180;
+        const double dx = std::sin(radian);
+        const double dy = std::cos(radian);
+        const double distanceX = std::abs(dx) > 1e-9 ? ((dx > 0 ? 200 : -200) - x) / dx : 1e9;
+        const double distanceY = std::abs(dy) > 1e-9 ? ((dy > 0 ? 200 : -200) - y) / dy : 1e9;
+        record.distances[i] = float(distanceX < distanceY ? distanceX : distanceY);
+    }
+    return record;
+}
+} // namespace
+
+TEST_CASE("ParallelScanInserter", "[replay]") {
+    using MapType = Mapping::Map2D<100, 70, Mapping::RowMajorLayout, Mapping::MapInstrumentation<Mapping::HostCycleCounter>>;
+    using Inserter = Mapping::ParallelScanInserter<MapType>;
+    std::unique_ptr<MapType> serial(new MapType(Mapping::Vector2D(50, 35), Mapping::Angle(), 1));
+    std::unique_ptr<MapType> parallel(new MapType(Mapping::Vector2D(50, 35), Mapping::Angle(), 1));
+    using Snapshots = Mapping::MapSnapshots<MapType, 8, 1024>;
+    std::unique_ptr<Snapshots> serialSnapshots(new Snapshots(*serial));
+    std::unique_ptr<Snapshots> parallelSnapshots(new Snapshots(*parallel));
+    Mapping::WorkStealingThreadPool pool(4);
+    Inserter inserter(pool);
+
+    uint32_t seed = 7;
+    for (int sweep = 0; sweep < 6; ++sweep) {
+        for (auto map : {serial.get(), parallel.get()}) {
+            map->setObstacleTimeToLive(2);
+            map->tick(uint32_t(sweep));
+            map->setSensorPosition(Mapping::Vector2D(30 + sweep * 8, 20 + sweep * 5));
+            map->setSensorRotation(Mapping::Angle(Mapping::AngleType::DEG, sweep * 17));
+            map->beginSweep();
+        }
+        serialSnapshots->takeSnapshot();
+        parallelSnapshots->takeSnapshot();
+        std::vector<Inserter::Measurement> measurements;
+        for (int i = 0; i < 720; ++i) {
+            seed = seed * 1103515245 + 12345;
+            measurements.push_back({Mapping::Angle(Mapping::AngleType::DEG, i * 0.5), double(5 + (seed >> 16) % 80)});
+        }
+        for (const auto &measurement : measurements) {
+            serial->addMeasurement(measurement.angle, measurement.distance);
+        }
+        inserter.addMeasurements(*parallel, measurements);
+
+        for (int y = 0; y < 70; ++y) {
+            for (int w = 0; w < MapType::GridType::wordsPerRow; ++w) {
+                REQUIRE(parallel->getGrid().getRowWord(y, w) == serial->getGrid().getRowWord(y, w));
+            }
+        }
+        REQUIRE(parallel->exploredCount() == serial->exploredCount());
+        REQUIRE(parallel->getChangedCellCount() == serial->getChangedCellCount());
+        REQUIRE(parallel->changedCellsOverflowed() == serial->changedCellsOverflowed());
+        for (int i = 0; i < serial->getChangedCellCount(); ++i) {
+            REQUIRE(parallel->getChangedCell(i) == serial->getChangedCell(i));
+        }
+        for (int tile = 0; tile < MapType::GridType::tileCount; ++tile) {
+            REQUIRE(parallel->getTileVersion(tile) == serial->getTileVersion(tile));
+        }
+    }
+    ///< The tile write hook saw the tiles in the same order.
+    std::vector<int> serialTiles;
+    std::vector<int> parallelTiles;
+    REQUIRE(serialSnapshots->diff(0, Snapshots::current, [&serialTiles](int tile) { serialTiles.push_back(tile); }));
+    REQUIRE(parallelSnapshots->diff(0, Snapshots::current, [&parallelTiles](int tile) { parallelTiles.push_back(tile); }));
+    REQUIRE_FALSE(serialTiles.empty());
+    REQUIRE(parallelTiles == serialTiles);
+    REQUIRE(parallel->getInstrumentation().getPointsInserted() == serial->getInstrumentation().getPointsInserted());
+    REQUIRE(parallel->getInstrumentation().getPointsRejected() == serial->getInstrumentation().getPointsRejected());
+    ///< The changes that did not fit in the log are counted as well.
+    serial->beginSweep();
+    parallel->beginSweep();
+    REQUIRE(serial->getInstrumentation().getMaxCellsChanged() > MapType::changeLogCapacity);
+    REQUIRE(parallel->getInstrumentation().getCellsChanged() == serial->getInstrumentation().getCellsChanged());
+    REQUIRE(parallel->getInstrumentation().getMaxCellsChanged() == serial->getInstrumentation().getMaxCellsChanged());
+}
+
+TEST_CASE("ReplayEngine", "[replay]") {
+    std::vector<Mapping::ScanRecord> log;
+    for (int i = 0; i < 20; ++i) {
+        log.push_back(createRoomSweep(-100 + 10 * i, 50 - 5 * i, 3 * i));
+    }
+
+    ///< The log survives a save and load.
+    const char *path = "test_scan.log";
+    REQUIRE(Mapping::saveScanLog(path, log));
+    std::vector<Mapping::ScanRecord> loaded;
+    REQUIRE(Mapping::loadScanLog(path, loaded));
+    std::remove(path);
+    REQUIRE(loaded.size() == log.size());
+    REQUIRE(loaded[7].x == Approx(log[7].x));
+    REQUIRE(loaded[7].distances[123] == Approx(log[7].distances[123]).margin(0.01));
+
+    ///< A log whose last sweep is cut off is not complete.
+    FILE *truncated = std::fopen(path, "w");
+    std::fprintf(truncated, "1 2 3 4 5\n");
+    std::fclose(truncated);
+    std::vector<Mapping::ScanRecord> partial;
+    REQUIRE_FALSE(Mapping::loadScanLog(path, partial));
+    std::remove(path);
+    REQUIRE(partial.empty());
+
+    std::vector<Mapping::ReplayConfig> configs(4);
+    configs[1].scale = 5;
+    configs[2].maxRange = 150;
+    configs[3].obstacleTimeToLive = 5;
+
+    Mapping::ReplayEngine<160, 160> engine(loaded);
+    Mapping::WorkStealingThreadPool pool(2);
+    auto results = engine.run(configs, pool);
+    REQUIRE(results.size() == 4);
+
+    ///< Running in parallel gives the same maps as running one by one.
+    for (size_t i = 0; i < configs.size(); ++i) {
+        auto serial = engine.replay(configs[i]);
+        REQUIRE(results[i].sweeps == 20);
+        REQUIRE(results[i].measurements == serial.measurements);
+        REQUIRE(results[i].obstacleCells == serial.obstacleCells);
+        REQUIRE(results[i].exploredCells == serial.exploredCells);
+        REQUIRE(results[i].endpointAgreement == serial.endpointAgreement);
+        REQUIRE(results[i].refusedPoses == 0);
+    }
+
+    ///< A pose outside of the map is reported, the sweep is replayed from the previous pose.
+    auto outside = loaded;
+    outside[5].x = 10000;
+    REQUIRE(Mapping::ReplayEngine<160, 160>(outside).replay(configs[0]).refusedPoses == 1);
+
+    ///< The walls are measured again and again, so most measurements agree with the map.
+    REQUIRE(results[0].endpointAgreement > 0.5);
+    ///< A lower range limit drops measurements.
+    REQUIRE(results[2].measurements < results[0].measurements);
+    ///< A coarser scale gives fewer obstacle points for the same walls.
+    REQUIRE(results[1].obstacleCells < results[0].obstacleCells);
+}
+
 TEST_CASE("Angle", "[angle]") {
     Mapping::Angle a1(Mapping::AngleType::DEG, 90);
 
@@ -78,3 +1264,34 @@ TEST_CASE("Angle", "[angle]") {
     a2.set(Mapping::AngleType::DEG, 722);
     REQUIRE(a2.asDegree() == 2);
 }
+
+TEST_CASE("Round", "[math]") {
+    REQUIRE(math::round(1.4) == 1);
+    REQUIRE(math::round(1.6) == 2);
+    REQUIRE(math::round(-1.4) == -1);
+    REQUIRE(math::round(-1.6) == -2);
+}
+
+TEST_CASE("sincos", "[math]") {
+    ///< An odd amount, so both the 4-wide and the single angle steps run.
+    std::vector<float> angles;
+    for (float angle = -1000; angle <= 1000; angle += 0.37f) {
+        angles.push_back(angle);
+    }
+    angles.push_back(0);
+    angles.push_back(3.14159265f / 4);
+    std::vector<float> sines(angles.size());
+    std::vector<float> cosines(angles.size());
+    math::sincos(angles.data(), sines.data(), cosines.data(), angles.size());
+    double maxError = 0;
+    for (size_t i = 0; i < angles.size(); ++i) {
+        maxError = std::max(maxError, std::abs(sines[i] - std::sin(double(angles[i]))));
+        maxError = std::max(maxError, std::abs(cosines[i] - std::cos(double(angles[i]))));
+    }
+    REQUIRE(maxError < 1e-6);
+    REQUIRE(sines[angles.size() - 2] == 0);
+    REQUIRE(cosines[angles.size() - 2] == 1);
+
+    ///< Nothing is written for an empty array.
+    math::sincos(nullptr, nullptr, nullptr, 0);
+}
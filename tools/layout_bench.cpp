@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @brief     Compares the row-major and Morton grid layouts (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ *
+ * Usage: layout_bench [sweeps]
+ */
+
+#include "map2d.hpp"
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+struct Timings {
+    double insertion = 0; ///< Seconds to add all sweeps of measurements.
+    double columns = 0;   ///< Seconds to read the whole map column by column.
+    double inflation = 0; ///< Seconds to check the neighborhood of every point.
+    long checksum = 0;    ///< Keeps the work from being optimized away, has to match between layouts.
+};
+
+template <class F>
+double measure(F function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+template <int mapSize, class Layout>
+Timings run(int sweeps) {
+    using MapType = Mapping::Map2D<mapSize, mapSize, Layout>;
+    std::unique_ptr<MapType> map(
+        new MapType(Mapping::Vector2D(mapSize / 2, mapSize / 2), Mapping::Angle(Mapping::AngleType::DEG, 0), 1));
+    Timings timings;
+    timings.insertion = measure([&map, sweeps]() {
+        uint32_t seed = 1;
+        for (int sweep = 0; sweep < sweeps; ++sweep) {
+            seed = seed * 1103515245 + 12345;
+            map->setSensorPosition(Mapping::Vector2D(mapSize / 4 + int(seed >> 8) % (mapSize / 2),
+                                                     mapSize / 4 + int(seed >> 20) % (mapSize / 2)));
+            map->beginSweep();
+            for (int degree = 0; degree < 360; ++degree) {
+                map->addMeasurement(Mapping::Angle(Mapping::AngleType::DEG, degree), 100 + (degree * 37 + sweep * 11) % 150);
+            }
+        }
+    });
+    timings.columns = measure([&map, &timings]() {
+        for (int x = 0; x < mapSize; ++x) {
+            for (int y = 0; y < mapSize; ++y) {
+                timings.checksum += map->isExplored(Mapping::Vector2D(x, y));
+            }
+        }
+    });
+    timings.inflation = measure([&map, &timings]() {
+        const auto &grid = map->getGrid();
+        for (int y = 0; y < mapSize; ++y) {
+            for (int x = 0; x < mapSize; ++x) {
+                timings.checksum += grid.getNeighborhood(x, y) != 0;
+            }
+        }
+    });
+    return timings;
+}
+
+void printRow(const char *name, double rowMajor, double morton) {
+    printf("%-12s %12.2f %12.2f %8.2fx\n", name, rowMajor * 1000, morton * 1000, morton > 0 ? rowMajor / morton : 0);
+}
+
+template <int mapSize>
+bool compare(int sweeps) {
+    const auto rowMajor = run<mapSize, Mapping::RowMajorLayout>(sweeps);
+    const auto morton = run<mapSize, Mapping::MortonLayout>(sweeps);
+
+    printf("%d x %d map, %d sweeps of 360 measurements\n", mapSize, mapSize, sweeps);
+    printf("%-12s %12s %12s %9s\n", "benchmark", "row-major ms", "morton ms", "speedup");
+    printRow("insertion", rowMajor.insertion, morton.insertion);
+    printRow("columns", rowMajor.columns, morton.columns);
+    printRow("inflation", rowMajor.inflation, morton.inflation);
+    printf("\n");
+    if (rowMajor.checksum != morton.checksum) {
+        fprintf(stderr, "The layouts gave different maps\n");
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    const int sweeps = argc > 1 ? atoi(argv[1]) : 2000;
+    ///< A map that fits in the cache, and one that does not.
+    const bool valid = compare<1024>(sweeps) && compare<4096>(sweeps);
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief     Lists the static memory footprint of map configurations (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ *
+ * Usage: memory_report
+ *
+ * The sizes are those of the host. Pointers are 4 bytes on the Due, so
+ * the components that hold pointers (Map2D, MapSnapshots) are a little
+ * smaller there; SramBudget checks the exact sizes when building for it.
+ */
+
+#include "frontier.hpp"
+#include "hit_deduplicator.hpp"
+#include "map2d.hpp"
+#include "map_snapshots.hpp"
+#include "map_stream.hpp"
+#include "memory_budget.hpp"
+#include "obstacle_labeler.hpp"
+#include <stdio.h>
+
+namespace {
+void printRow(const char *name, size_t bytes) {
+    printf("  %-34s %9zu %7.1f%%\n", name, bytes, 100.0 * bytes / Mapping::MemoryBudget::dueStack);
+}
+
+template <class MapType>
+void printMap(const char *name) {
+    printRow(name, sizeof(MapType));
+    printRow("  grids", MapType::gridFootprint());
+    printRow("  change log", MapType::changeLogFootprint());
+    printRow("  tile stamps and versions", MapType::tileFootprint());
+    printRow("  other", sizeof(MapType) - MapType::gridFootprint() - MapType::changeLogFootprint() - MapType::tileFootprint());
+}
+
+template <int size>
+void printConfiguration() {
+    using MapType = Mapping::Map2D<size, size>;
+    using Frontier = Mapping::FrontierDetector<size, size>;
+    using Labeler = Mapping::ObstacleLabeler<size, size>;
+    using Encoder = Mapping::MapStreamEncoder<size, size>;
+
+    printf("%d x %d map\n", size, size);
+    printMap<MapType>("Map2D");
+    printRow("Map2D, Morton layout", sizeof(Mapping::Map2D<size, size, Mapping::MortonLayout>));
+    printRow("Map2D, instrumented",
+             sizeof(Mapping::Map2D<size, size, Mapping::RowMajorLayout, Mapping::MapInstrumentation<Mapping::DwtCycleCounter>>));
+    printRow("MapSnapshots", sizeof(Mapping::MapSnapshots<MapType>));
+    printRow("HitDeduplicator", sizeof(Mapping::HitDeduplicator<MapType>));
+    printRow("FrontierDetector", sizeof(Frontier));
+    printRow("ObstacleLabeler", sizeof(Labeler));
+    printRow("MapStreamEncoder", sizeof(Encoder));
+    printRow("MapStreamDecoder", sizeof(Mapping::MapStreamDecoder<size, size>));
+    const size_t total = Mapping::MemoryBudget::footprint<MapType, Frontier, Labeler, Encoder>();
+    printRow("map + frontier + labeler + encoder", total);
+    printf("  %s\n\n", total <= Mapping::MemoryBudget::dueStack ? "fits on the stack" : "DOES NOT FIT on the stack");
+}
+
+template <class Config>
+void printSweepTable(const char *name) {
+    printf("  %-34s %9zu  (flash)\n", name, sizeof(Mapping::SweepTable<Config>));
+}
+} // namespace
+
+int main() {
+    printf("Static memory footprint in bytes, and the share of the stack of the Due (%zu bytes)\n",
+           Mapping::MemoryBudget::dueStack);
+    printf("Host sizes: pointers are %zu bytes here, 4 on the Due\n\n", sizeof(void *));
+    printConfiguration<64>();
+    printConfiguration<128>();
+    printConfiguration<256>();
+
+    printf("Sweep tables\n");
+    printSweepTable<Mapping::MapConfig<50, 1000>>("1 degree steps");
+    printSweepTable<Mapping::MapConfig<50, 500>>("0.5 degree steps");
+    printSweepTable<Mapping::MapConfig<50, 250>>("0.25 degree steps");
+    return 0;
+}
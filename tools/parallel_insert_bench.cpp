@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @brief     Compares serial and tile-parallel scan insertion (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ *
+ * Usage: parallel_insert_bench [sweeps] [returns per sweep]
+ */
+
+#include "host/parallel_insertion.hpp"
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+namespace {
+constexpr int mapSize = 1024;
+using MapType = Mapping::Map2D<mapSize, mapSize>;
+using Inserter = Mapping::ParallelScanInserter<MapType>;
+
+template <class F>
+double measure(F function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+std::vector<std::vector<Inserter::Measurement>> makeSweeps(int sweeps, int returns) {
+    std::vector<std::vector<Inserter::Measurement>> result(sweeps);
+    uint32_t seed = 1;
+    for (auto &sweep : result) {
+        for (int i = 0; i < returns; ++i) {
+            seed = seed * 1103515245 + 12345;
+            sweep.push_back({Mapping::Angle(Mapping::AngleType::DEG, 360.0 * i / returns), double(50 + (seed >> 16) % 400)});
+        }
+    }
+    return result;
+}
+
+void placeSensor(MapType &map, int sweep) {
+    map.setSensorPosition(Mapping::Vector2D(mapSize / 2 + (sweep * 37) % 200, mapSize / 2 + (sweep * 53) % 200));
+    map.beginSweep();
+}
+
+bool sameMaps(const MapType &a, const MapType &b) {
+    for (int y = 0; y < mapSize; ++y) {
+        for (int w = 0; w < MapType::GridType::wordsPerRow; ++w) {
+            if (a.getGrid().getRowWord(y, w) != b.getGrid().getRowWord(y, w)) {
+                return false;
+            }
+        }
+    }
+    return a.exploredCount() == b.exploredCount() && a.getChangedCellCount() == b.getChangedCellCount();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    const int sweepCount = argc > 1 ? atoi(argv[1]) : 20;
+    const int returns = argc > 2 ? atoi(argv[2]) : 4000;
+    const auto sweeps = makeSweeps(sweepCount, returns);
+
+    std::unique_ptr<MapType> serial(new MapType(Mapping::Vector2D(mapSize / 2, mapSize / 2), Mapping::Angle(), 1));
+    const double serialSeconds = measure([&]() {
+        for (int sweep = 0; sweep < sweepCount; ++sweep) {
+            placeSensor(*serial, sweep);
+            for (const auto &measurement : sweeps[sweep]) {
+                serial->addMeasurement(measurement.angle, measurement.distance);
+            }
+        }
+    });
+    printf("%d x %d map, %d sweeps of %d returns, %u hardware threads\n", mapSize, mapSize, sweepCount, returns,
+           std::thread::hardware_concurrency());
+    printf("%-10s %10s %12s %8s\n", "threads", "ms", "sweeps/s", "speedup");
+    printf("%-10s %10.1f %12.1f %8s\n", "serial", serialSeconds * 1000, sweepCount / serialSeconds, "1.00x");
+
+    bool identical = true;
+    for (int threads = 1; threads <= 16; threads *= 2) {
+        Mapping::WorkStealingThreadPool pool(threads);
+        Inserter inserter(pool);
+        std::unique_ptr<MapType> map(new MapType(Mapping::Vector2D(mapSize / 2, mapSize / 2), Mapping::Angle(), 1));
+        const double seconds = measure([&]() {
+            for (int sweep = 0; sweep < sweepCount; ++sweep) {
+                placeSensor(*map, sweep);
+                inserter.addMeasurements(*map, sweeps[sweep]);
+            }
+        });
+        identical = identical && sameMaps(*map, *serial);
+        printf("%-10d %10.1f %12.1f %7.2fx\n", threads, seconds * 1000, sweepCount / seconds, serialSeconds / seconds);
+    }
+    if (!identical) {
+        fprintf(stderr, "The parallel insertion gave a different map\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief     Replays a scan log with many mapping configurations (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ *
+ * Usage: replay <scan log> [threads]
+ */
+
+#include "host/replay.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+constexpr int mapWidth = 256;
+constexpr int mapHeight = 256;
+
+std::vector<Mapping::ReplayConfig> createConfigs() {
+    std::vector<Mapping::ReplayConfig> configs;
+    for (double scale : {2.0, 3.0, 5.0, 8.0}) {
+        for (double maxRange : {200.0, 400.0, 800.0}) {
+            for (uint32_t timeToLive : {0u, 50u}) {
+                Mapping::ReplayConfig config;
+                config.scale = scale;
+                config.maxRange = maxRange;
+                config.obstacleTimeToLive = timeToLive;
+                configs.push_back(config);
+            }
+        }
+    }
+    return configs;
+}
+
+void printResults(const std::vector<Mapping::ReplayResult> &results) {
+    printf("%8s %8s %6s %10s %12s %9s %9s %9s %8s\n", "scale", "maxRange", "ttl", "sweeps/s", "measurements", "obstacles",
+           "explored", "agreement", "refused");
+    for (const auto &result : results) {
+        printf("%8.1f %8.0f %6u %10.1f %12ld %9d %9d %9.3f %8d\n", result.config.scale, result.config.maxRange,
+               result.config.obstacleTimeToLive, result.sweepsPerSecond, result.measurements, result.obstacleCells,
+               result.exploredCells, result.endpointAgreement, result.refusedPoses);
+    }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <scan log> [threads]\n", argv[0]);
+        return 1;
+    }
+    std::vector<Mapping::ScanRecord> log;
+    if (!Mapping::loadScanLog(argv[1], log)) {
+        fprintf(stderr, "Could not read scan log %s\n", argv[1]);
+        return 1;
+    }
+    Mapping::WorkStealingThreadPool pool(argc > 2 ? atoi(argv[2]) : 0);
+    Mapping::ReplayEngine<mapWidth, mapHeight> engine(log);
+    const auto configs = createConfigs();
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto results = engine.run(configs, pool);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    printResults(results);
+    printf("\n%zu configurations x %zu sweeps on %d threads in %.2f s (%.1f sweeps/s)\n", configs.size(), log.size(),
+           pool.getThreadCount(), elapsed.count(), configs.size() * log.size() / elapsed.count());
+    return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file
+ * @brief     Compares math::sincos with calling sin and cos per angle (host only)
+ * @author    Bendeguz Toth
+ * @license   See LICENSE
+ *
+ * Usage: sincos_bench [angles]
+ */
+
+#include "math/math.hpp"
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+template <class F>
+double measure(F function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+double checksum(const std::vector<float> &sines, const std::vector<float> &cosines) {
+    double sum = 0;
+    for (size_t i = 0; i < sines.size(); ++i) {
+        sum += sines[i] + cosines[i];
+    }
+    return sum;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    const size_t count = argc > 1 ? size_t(atol(argv[1])) : 1000000;
+    ///< Angles of a full turn, like the rays of a sweep.
+    std::vector<float> angles(count);
+    for (size_t i = 0; i < count; ++i) {
+        angles[i] = float(i % 3600) * 0.1f * 3.14159265f / 180 - 3.14159265f;
+    }
+    std::vector<float> sines(count);
+    std::vector<float> cosines(count);
+
+    const double scalar = measure([&]() {
+        for (size_t i = 0; i < count; ++i) {
+            sines[i] = math::sin(angles[i]);
+            cosines[i] = math::cos(angles[i]);
+        }
+    });
+    const double scalarSum = checksum(sines, cosines);
+    const double standard = measure([&]() {
+        for (size_t i = 0; i < count; ++i) {
+            sines[i] = std::sin(angles[i]);
+            cosines[i] = std::cos(angles[i]);
+        }
+    });
+    const double standardSum = checksum(sines, cosines);
+    const double batch = measure([&]() { math::sincos(angles.data(), sines.data(), cosines.data(), count); });
+    const double batchSum = checksum(sines, cosines);
+
+    printf("%zu angles\n", count);
+    printf("%-22s %10s %10s %12s\n", "", "ms", "ns/angle", "checksum");
+    printf("%-22s %10.2f %10.2f %12.4f\n", "math::sin + math::cos", scalar * 1000, scalar * 1e9 / count, scalarSum);
+    printf("%-22s %10.2f %10.2f %12.4f\n", "std::sin + std::cos", standard * 1000, standard * 1e9 / count, standardSum);
+    printf("%-22s %10.2f %10.2f %12.4f\n", "math::sincos", batch * 1000, batch * 1e9 / count, batchSum);
+    printf("\nmath::sincos is %.1fx faster than math::sin + math::cos, %.1fx faster than std::sin + std::cos\n",
+           scalar / batch, standard / batch);
+    return 0;
+}